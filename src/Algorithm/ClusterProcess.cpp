@@ -76,20 +76,17 @@ ClusterResult ClusterProcess::process(const SequenceWorkItem& item)
         std::vector<ClusterNode>::const_iterator iter = result.clusterNodes.begin();
         for(; iter != result.clusterNodes.end(); ++iter)
         {
-            for(int64_t i = iter->interval.lower; i <= iter->interval.upper; ++i)
+            const BWTInterval& interval = iter->interval;
+            size_t expected = interval.upper - interval.lower + 1;
+            if(interval.lower <= lowestIndex && lowestIndex <= interval.upper) //already set
+                expected -= 1;
+
+            size_t numSet = m_parameters.pMarkedReads->setRange(interval.lower, interval.upper);
+            if(numSet != expected)
             {
-                if(i == lowestIndex) //already set
-                    continue;
-                currentValue = m_parameters.pMarkedReads->test(i);
-                if(currentValue)
-                {
-                    // This value should not be true, emit a warning
-                    std::cout << "Warning: Bit " << i << " was unexpectedly set by a different thread\n";
-                }
-                else
-                {
-                    m_parameters.pMarkedReads->updateCAS(i, currentValue, true);
-                }
+                // These bits should not have been set, emit a warning
+                std::cout << "Warning: " << expected - numSet << " bits in [" << interval.lower << "," 
+                          << interval.upper << "] were unexpectedly set by a different thread\n";
             }
         }
     }
@@ -168,25 +168,20 @@ FMMergeResult FMMergeProcess::process(const SequenceWorkItem& item)
         {
             // We successfully atomically set the bit for the first read in this set
             // to true. We can safely update the rest of the bits and keep the merged sequences
-            // for output.
+            // for output. Each interval is marked with a single range update.
             std::vector<BWTInterval>::const_iterator iter = result.usedIntervals.begin();
             for(; iter != result.usedIntervals.end(); ++iter)
             {
-                for(int64_t i = iter->lower; i <= iter->upper; ++i)
+                size_t expected = iter->upper - iter->lower + 1;
+                if(iter->lower <= lowestIndex && lowestIndex <= iter->upper) //already set
+                    expected -= 1;
+
+                size_t numSet = m_pMarkedReads->setRange(iter->lower, iter->upper);
+                if(numSet != expected)
                 {
-                    if(i == lowestIndex) //already set
-                        continue;
-
-                    currentValue = m_pMarkedReads->test(i);
-                    if(currentValue)
-                    {
-                        // This value should not be true, emit a warning
-                        std::cout << "Warning: Bit " << i << " was set outside of critical section\n";
-                    }
-                    else
-                    {
-                        m_pMarkedReads->updateCAS(i, currentValue, true);
-                    }
+                    // These bits should not have been set, emit a warning
+                    std::cout << "Warning: " << expected - numSet << " bits in [" << iter->lower << "," 
+                              << iter->upper << "] were set outside of critical section\n";
                 }
             }
         }
@@ -23,6 +23,15 @@ GapFillStats::GapFillStats()
         numFails[i] = 0;
 }
 
+//
+void GapFillStats::add(const GapFillStats& other)
+{
+    numGapsAttempted += other.numGapsAttempted;
+    numGapsFilled += other.numGapsFilled;
+    for(size_t i = 0; i < GFRC_NUM_CODES; ++i)
+        numFails[i] += other.numFails[i];
+}
+
 //
 void GapFillStats::print() const
 {
@@ -47,15 +56,18 @@ GapFillProcess::GapFillProcess(const GapFillParameters& params) : m_parameters(p
 //
 GapFillProcess::~GapFillProcess()
 {
-    m_stats.print();
+
+}
+
+//
+GapFillResult GapFillProcess::process(const GapFillWorkItem& item) const
+{
+    return processScaffold(item.sequence);
 }
 
 // Process the given scaffold, filling in any gaps found
 GapFillResult GapFillProcess::processScaffold(const std::string& scaffold) const
 {
-    if(m_parameters.verbose > 0)
-        std::cout << "Processing scaffold of length " << scaffold.length() << "\n";
-    
     GapFillResult result;
 
     size_t len = scaffold.length();
@@ -114,7 +126,7 @@ GapFillResult GapFillProcess::processScaffold(const std::string& scaffold) const
                     // input scaffold that is not already assembled. This is given
                     // by the position of the rightAnchor, plus a kmer
                     currIdx = rightAnchor.position + k;
-                    m_stats.numGapsFilled += 1;
+                    result.stats.numGapsFilled += 1;
                     break; 
                 }
             }
@@ -122,7 +134,7 @@ GapFillResult GapFillProcess::processScaffold(const std::string& scaffold) const
             if(code != GFRC_OK)
             {
                 // Failed to resolve the gap. Append the gap into the growing scaffold
-                m_stats.numFails[code] += 1;
+                result.stats.numFails[code] += 1;
 
                 while(scaffold[currIdx] == 'N')
                 {
@@ -130,12 +142,9 @@ GapFillResult GapFillProcess::processScaffold(const std::string& scaffold) const
                     currIdx += 1;
                 }
             }
-            m_stats.numGapsAttempted += 1;
+            result.stats.numGapsAttempted += 1;
         }
     }
-
-    if(m_parameters.verbose >= 2)
-        StdAlnTools::globalAlignment(scaffold, result.scaffold, true);
     return result;
 }
 
@@ -191,8 +200,7 @@ AnchorSequence GapFillProcess::findAnchor(size_t k, const std::string& scaffold,
 {
     AnchorSequence anchor;
     int64_t stride = upstream ? -1 : 1;
-    int MAX_DISTANCE = 50;
-    int64_t stop = upstream ? position - MAX_DISTANCE : position + MAX_DISTANCE;
+    int64_t stop = upstream ? position - MAX_ANCHOR_DISTANCE : position + MAX_ANCHOR_DISTANCE;
 
     // Cap the travel distance to avoid out of bounds
     if(stop < 0)
@@ -255,3 +263,121 @@ GapFillReturnCode GapFillProcess::selectGapSequence(int estimatedSize, const Str
     return GFRC_OK;
 }
 
+
+//
+// GapFillWorkItemGenerator
+//
+GapFillWorkItemGenerator::GapFillWorkItemGenerator(SeqReader* pReader, 
+                                                   size_t maxKmer, 
+                                                   int verbose) : m_pReader(pReader), 
+                                                                  m_maxKmer(maxKmer),
+                                                                  m_verbose(verbose),
+                                                                  m_numConsumed(0),
+                                                                  m_nextSegment(0)
+{
+
+}
+
+//
+bool GapFillWorkItemGenerator::generate(GapFillWorkItem& out)
+{
+    if(m_nextSegment == m_segments.size())
+    {
+        // Start the next scaffold
+        SeqRecord record;
+        if(!m_pReader->get(record))
+            return false;
+
+        std::string scaffold = record.seq.toString();
+        if(m_verbose > 0)
+            std::cout << "Processing scaffold of length " << scaffold.length() << "\n";
+
+        m_currID = record.id;
+        m_segments.clear();
+        splitScaffold(scaffold, m_maxKmer, m_segments);
+        m_nextSegment = 0;
+    }
+
+    out.id = m_currID;
+    out.sequence = m_segments[m_nextSegment];
+    out.segmentIdx = m_nextSegment;
+    out.numSegments = m_segments.size();
+    m_nextSegment += 1;
+    m_numConsumed += 1;
+    return true;
+}
+
+// The scaffold is cut in the middle of a contig when both halves are longer than 
+// the furthest an anchor can be placed from a gap plus the kmer length. 
+// The anchors for the gaps on either side of the cut then only use sequence
+// from their own half so the segments give the same result as the whole scaffold.
+void GapFillWorkItemGenerator::splitScaffold(const std::string& scaffold, size_t maxKmer, StringVector& outSegments)
+{
+    size_t minHalfLength = maxKmer + GapFillProcess::MAX_ANCHOR_DISTANCE + 1;
+    size_t segmentStart = 0;
+    size_t prevGapEnd = std::string::npos;
+    size_t len = scaffold.length();
+    size_t currIdx = 0;
+
+    while(currIdx < len)
+    {
+        if(scaffold[currIdx] != 'N')
+        {
+            currIdx += 1;
+            continue;
+        }
+
+        // Found the start of a gap. If the contig from the previous gap is
+        // long enough, cut it in half
+        if(prevGapEnd != std::string::npos && currIdx - prevGapEnd >= 2 * minHalfLength)
+        {
+            size_t cut = prevGapEnd + (currIdx - prevGapEnd) / 2;
+            outSegments.push_back(scaffold.substr(segmentStart, cut - segmentStart));
+            segmentStart = cut;
+        }
+
+        while(currIdx < len && scaffold[currIdx] == 'N')
+            currIdx += 1;
+        prevGapEnd = currIdx;
+    }
+
+    outSegments.push_back(scaffold.substr(segmentStart));
+}
+
+//
+// GapFillPostProcess
+//
+GapFillPostProcess::GapFillPostProcess(std::ostream* pWriter, int verbose) : m_pWriter(pWriter), m_verbose(verbose)
+{
+
+}
+
+//
+GapFillPostProcess::~GapFillPostProcess()
+{
+    m_stats.print();
+}
+
+//
+void GapFillPostProcess::process(const GapFillWorkItem& item, const GapFillResult& result)
+{
+    m_stats.add(result.stats);
+    m_filledScaffold.append(result.scaffold);
+    if(m_verbose >= 2)
+        m_inputScaffold.append(item.sequence);
+
+    // Write out the scaffold once all its segments have been filled
+    if(item.segmentIdx + 1 == item.numSegments)
+    {
+        if(m_verbose >= 2)
+            StdAlnTools::globalAlignment(m_inputScaffold, m_filledScaffold, true);
+
+        SeqRecord record;
+        record.id = item.id;
+        record.seq = m_filledScaffold;
+        record.write(*m_pWriter);
+
+        m_inputScaffold.clear();
+        m_filledScaffold.clear();
+    }
+}
@@ -21,6 +21,7 @@
 #include "SequenceProcessFramework.h"
 #include "BWTIntervalCache.h"
 #include "SampledSuffixArray.h"
+#include "SeqReader.h"
 
 // Structures and typedefs
 
@@ -42,12 +43,6 @@ struct GapFillParameters
     int verbose;
 };
 
-// 
-struct GapFillResult
-{
-    std::string scaffold;
-};
-
 enum GapFillReturnCode
 {
     GFRC_UNKNOWN,
@@ -72,9 +67,30 @@ struct GapFillStats
     // Failure stats
     size_t numFails[GFRC_NUM_CODES];
 
+    void add(const GapFillStats& other);
     void print() const;
 };
 
+// A piece of a scaffold that can be gap filled independently 
+// of the rest of the scaffold. The scaffold is split in the middle
+// of contigs that are long enough that the anchors found for the gaps
+// on either side cannot interact so the segments can be processed
+// in parallel and concatenated.
+struct GapFillWorkItem
+{
+    std::string id;
+    std::string sequence;
+    size_t segmentIdx;
+    size_t numSegments;
+};
+
+// 
+struct GapFillResult
+{
+    std::string scaffold;
+    GapFillStats stats;
+};
+
 //
 //
 //
@@ -87,10 +103,16 @@ class GapFillProcess
         //
         GapFillProcess(const GapFillParameters& params);
         ~GapFillProcess();
+
+        // Fill the gaps in one segment of a scaffold
+        GapFillResult process(const GapFillWorkItem& item) const;
         
-        // Generate haplotypes from chromosome refName, position [start, end]
+        // Fill the gaps in the given scaffold
         GapFillResult processScaffold(const std::string& scaffold) const;
 
+        // The maximum distance from the gap that is searched for an anchor
+        static const int MAX_ANCHOR_DISTANCE = 50;
+
     private:
         
         //
@@ -115,24 +137,50 @@ class GapFillProcess
         // Data
         //
         GapFillParameters m_parameters;
-        mutable GapFillStats m_stats;
 };
 
-#if 0
-// 
-class GapFillPostProcess
+// Read scaffolds and split them into work items
+class GapFillWorkItemGenerator
 {
+    public:
+        GapFillWorkItemGenerator(SeqReader* pReader, size_t maxKmer, int verbose);
+
+        bool generate(GapFillWorkItem& out);
+        inline size_t getNumConsumed() const { return m_numConsumed; }
 
+        // Split the scaffold into segments that can be filled independently
+        static void splitScaffold(const std::string& scaffold, size_t maxKmer, StringVector& outSegments);
+
+    private:
+        SeqReader* m_pReader;
+        size_t m_maxKmer;
+        int m_verbose;
+        size_t m_numConsumed;
+
+        // The scaffold currently being split into work items
+        std::string m_currID;
+        StringVector m_segments;
+        size_t m_nextSegment;
+};
+
+// Join the filled segments back together and write
+// the scaffolds in the order they were read
+class GapFillPostProcess
+{
     public:
-        GapFillPostProcess(const std::string& filename);
+        GapFillPostProcess(std::ostream* pWriter, int verbose);
         ~GapFillPostProcess();
 
-        //void process(const SequenceWorkItem& item, const GraphCompareResult& result);
-
+        void process(const GapFillWorkItem& item, const GapFillResult& result);
 
     private:
         std::ostream* m_pWriter;
+        int m_verbose;
+        GapFillStats m_stats;
+
+        // The scaffold currently being assembled
+        std::string m_inputScaffold;
+        std::string m_filledScaffold;
 };
-#endif
 
 #endif
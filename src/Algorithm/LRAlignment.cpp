@@ -53,25 +53,100 @@ bool LRCell::hasUninitializedChild() const
     return children_idx[0] == -1 || children_idx[1] == -1 || children_idx[2] == -1 ||  children_idx[3] == -1;
 }
 
+// The number of target nodes cached by a workspace before the cache is emptied
+static const size_t LR_MAX_CACHED_TARGET_NODES = 1 << 20;
+
+//
+LRWorkspace::LRWorkspace(const BWT* pTargetBWT) : m_pTargetBWT(pTargetBWT)
+{
+
+}
+
+//
+LRWorkspace::~LRWorkspace()
+{
+    assert(stack.empty());
+    for(size_t i = 0; i < m_freeEntries.size(); ++i)
+        delete m_freeEntries[i];
+}
+
+// Calculate the intervals of all four children of the node
+// with one pair of occurrence lookups and save them
+LRTargetChildren LRWorkspace::getTargetChildren(const BWTInterval& interval)
+{
+    LRTargetChildMap::iterator iter = m_targetChildren.find(interval);
+    if(iter != m_targetChildren.end())
+        return iter->second;
+
+    LRTargetChildren children;
+    AlphaCount64 lower = m_pTargetBWT->getFullOcc(interval.lower - 1);
+    AlphaCount64 upper = m_pTargetBWT->getFullOcc(interval.upper);
+    for(int ci = 0; ci < DNA_ALPHABET::size; ++ci)
+    {
+        char b = DNA_ALPHABET::getBase(ci);
+        size_t pb = m_pTargetBWT->getPC(b);
+        children.interval[ci].lower = pb + lower.get(b);
+        children.interval[ci].upper = pb + upper.get(b) - 1;
+    }
+
+    if(m_targetChildren.size() >= LR_MAX_CACHED_TARGET_NODES)
+        m_targetChildren.clear();
+    m_targetChildren.insert(std::make_pair(interval, children));
+    return children;
+}
+
+//
+LRStackEntry* LRWorkspace::createEntry()
+{
+    if(m_freeEntries.empty())
+        return new LRStackEntry;
+
+    LRStackEntry* entry = m_freeEntries.back();
+    m_freeEntries.pop_back();
+    return entry;
+}
+
+//
+void LRWorkspace::releaseEntry(LRStackEntry* entry)
+{
+    entry->cells.clear();
+    m_freeEntries.push_back(entry);
+}
+
 // Implementation of bwa-sw algorithm.
 // Roughly follows Heng Li's implementation 
 void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const SampledSuffixArray* pTargetSSA, const LRParams& params, LRHitVector& outHits)
+{
+    LRWorkspace workspace(pTargetBWT);
+    bwaswAlignment(query, pTargetBWT, pTargetSSA, params, &workspace, outHits);
+}
+
+// Align the queries one after another, sharing the workspace
+void bwaswAlignmentBatch(const StringVector& queries, const BWT* pTargetBWT, const SampledSuffixArray* pTargetSSA, const LRParams& params, std::vector<LRHitVector>& outHits)
+{
+    LRWorkspace workspace(pTargetBWT);
+    outHits.resize(queries.size());
+    for(size_t i = 0; i < queries.size(); ++i)
+        bwaswAlignment(queries[i], pTargetBWT, pTargetSSA, params, &workspace, outHits[i]);
+}
+
+//
+void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const SampledSuffixArray* pTargetSSA, const LRParams& params, LRWorkspace* pWorkspace, LRHitVector& outHits)
 {
     // Construct an FM-index of the query sequence
     BWT* pQueryBWT = NULL;
     SuffixArray* pQuerySA = NULL;
     createQuickBWT(query, pQueryBWT, pQuerySA);
     
-    // Interval hash table used to mark cells as being duplicate
-    LRHash dupHash;
-
     // Initialize the hash table of DAWG nodes
-    LRHash dawgHash;
+    LRHash& dawgHash = pWorkspace->dawgHash;
+    dawgHash.clear();
     initializeDAWGHash(pQueryBWT, dawgHash);
     
     // Initialize a stack of elements with a single entry for the root node
     // of the query DAWG
-    LRStack stack;
+    LRStack& stack = pWorkspace->stack;
+    assert(stack.empty());
     
     // High scoring alignments are stored as LRHits in these vectors
     // positionHitsVector stores up to 2 hits starting at every base of the query sequence
@@ -82,11 +157,11 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
     // Each dawg node is added to the pendingVector initially
     // Once all predecessors of the node have been visited,
     // the node is moved to the stack
-    LRPendingVector pendingVector;
+    pWorkspace->pendingVector.clear();
     size_t num_pending = 0;
 
     // Initialize a stack entry for the root node with an empty scoring cell
-    LRStackEntry* pInitial = new LRStackEntry;
+    LRStackEntry* pInitial = pWorkspace->createEntry();
     pInitial->interval.lower = 0;
     pInitial->interval.upper = pQueryBWT->getBWLen() - 1;
 
@@ -108,23 +183,32 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
         
         size_t old_n = v->cells.size();
 
+        // The deletion score of each cell of v is the same for every child of the
+        // query node. It is calculated on the first visit to the cell and reused
+        // for the other children.
+        IntVector& deletionScores = pWorkspace->deletionScores;
+        deletionScores.clear();
+
         // TODO: bandwidth test and max depth ?
         
         // Descend into the children of the current dawg node
         // If the interval update succeeds, calculate scores between
         // the child node and all the LRCells of the current node
+        AlphaCount64 query_lower = pQueryBWT->getFullOcc(v->interval.lower - 1);
+        AlphaCount64 query_upper = pQueryBWT->getFullOcc(v->interval.upper);
         for(int qci = 0; qci < DNA_ALPHABET::size; ++qci)
         {
             char query_child_base = DNA_ALPHABET::getBase(qci);
-            BWTInterval child_interval = v->interval;
-            BWTAlgorithms::updateInterval(child_interval, query_child_base, pQueryBWT);
+            size_t pb = pQueryBWT->getPC(query_child_base);
+            BWTInterval child_interval(pb + query_lower.get(query_child_base), 
+                                       pb + query_upper.get(query_child_base) - 1);
 
             if(!child_interval.isValid())
                 continue;
     
             // Create an new array of cells for the scores between the child node
             // and all the nodes in the prefix tree
-            LRStackEntry* u = new LRStackEntry;
+            LRStackEntry* u = pWorkspace->createEntry();
             u->interval = child_interval;
 
             // Loop over the nodes in v
@@ -132,6 +216,10 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
             {
                 LRCell* p = &v->cells[i];
 
+                if(i == deletionScores.size())
+                    deletionScores.push_back(calculateDeletionScore(params, p));
+                int deletion_score = deletionScores[i];
+
                 if(p->interval.upper == -1)
                     continue; // duplicate that has been deleted
                 LRCell x; // the cell being calculated
@@ -152,7 +240,7 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
                     c[3] = &v->cells[p->parent_idx];
 
                     int match_score = qci == p->parent_cidx ? params.alnParams.match : -params.alnParams.mismatch;
-                    int score = fillCells(params, match_score, c);
+                    int score = fillCells(params, match_score, deletion_score, c);
 
                     if(score > 0)
                     {
@@ -169,11 +257,7 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
                 }
                 else
                 {
-                    if(p->D > p->G - params.alnParams.gap_open)
-                        x.D = p->D - params.alnParams.gap_ext; // extend gap
-                    else
-                        x.D = p->G - params.alnParams.gap_open_extend; // open a new gap
-
+                    x.D = deletion_score;
                     if(x.D > 0)
                     {
                         x.G = x.D;
@@ -202,13 +286,12 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
                 {
                     if(p->hasUninitializedChild())
                     {
+                        LRTargetChildren target_children = pWorkspace->getTargetChildren(p->interval);
                         for(int tci = 0; tci < DNA_ALPHABET::size; ++tci)
                         {
                             if(p->children_idx[tci] != -1)
                                 continue; // already added
-                            char target_child_base = DNA_ALPHABET::getBase(tci);
-                            BWTInterval target_child_interval = p->interval;
-                            BWTAlgorithms::updateInterval(target_child_interval, target_child_base, pTargetBWT);
+                            const BWTInterval& target_child_interval = target_children.interval[tci];
                             if(!target_child_interval.isValid()) // child with this extension base does not exist
                             {
                                 p->children_idx[tci] = -2;
@@ -245,12 +328,12 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
             }
 
             // Update the stack by adding u or pushing it to the pending vector
-            num_pending += updateStack(&stack, u, &pendingVector, &dawgHash, params);
+            num_pending += updateStack(pWorkspace, u, params);
 
         } // for qci
         
         // done with v
-        delete v;
+        pWorkspace->releaseEntry(v);
     } // for all stack
 
     assert(num_pending == 0);
@@ -269,15 +352,15 @@ void bwaswAlignment(const std::string& query, const BWT* pTargetBWT, const Sampl
 
 // Update the stack to contain entry u, after considering any possible merges
 // with StackEntries from the pending vector
-int updateStack(LRStack* pStack, 
+int updateStack(LRWorkspace* pWorkspace, 
                 LRStackEntry* u, 
-                LRPendingVector* pPendingVector, 
-                LRHash* pDawgHash, 
                 const LRParams& params)
 {
-    // Find the iterator for u in the dawgHash
-    LRHash dupHash;
+    LRStack* pStack = &pWorkspace->stack;
+    LRPendingVector* pPendingVector = &pWorkspace->pendingVector;
+    LRHash* pDawgHash = &pWorkspace->dawgHash;
 
+    // Find the iterator for u in the dawgHash
     uint64_t key = u->interval.lower << 32 | u->interval.upper;
     LRHash::iterator hashIter = pDawgHash->find(key);
     assert(hashIter != pDawgHash->end() && (uint32_t)hashIter->second > 0);
@@ -309,7 +392,7 @@ int updateStack(LRStack* pStack,
         {
             // this node in the dawg will not be visited again
             // move the stack entry from the pending list to the stack
-            removeDuplicateCells(w, dupHash);
+            removeDuplicateCells(w, pWorkspace->dupHash);
             cutTail(w, params);
             pStack->push(w);
             (*pPendingVector)[position - 1] = 0;
@@ -317,7 +400,7 @@ int updateStack(LRStack* pStack,
         }
 
         // u is empty or merged, it is no longer needed
-        delete u;
+        pWorkspace->releaseEntry(u);
 
     }
     else if(count > 0)
@@ -337,7 +420,7 @@ int updateStack(LRStack* pStack,
         else
         {
             // u has no cells to calculate, discard it
-            delete u;
+            pWorkspace->releaseEntry(u);
         }
     }
     else // count == 0, pos == 0
@@ -587,6 +670,13 @@ void removeDuplicateCells(LRStackEntry* u, LRHash& hash)
 
 // Fill the values of C[0] depending on the values in the other 3 cells
 int fillCells(const LRParams& params, int match_score, LRCell* c[4])
+{
+    int deletion_score = c[2] ? calculateDeletionScore(params, c[2]) : MINUS_INF;
+    return fillCells(params, match_score, deletion_score, c);
+}
+
+// Fill the values of C[0] using the deletion score calculated from c[2]
+int fillCells(const LRParams& params, int match_score, int deletion_score, LRCell* c[4])
 {
 	int G = c[3] ? c[3]->G + match_score : MINUS_INF;
 	if(c[1]) 
@@ -603,22 +693,21 @@ int fillCells(const LRParams& params, int match_score, LRCell* c[4])
         c[0]->I = MINUS_INF;
     }
 
-	if(c[2])
-    {
-		if(c[2]->D > c[2]->G - params.alnParams.gap_open)
-            c[0]->D = c[2]->D - params.alnParams.gap_ext; // extend gap
-        else
-            c[0]->D = c[2]->G - params.alnParams.gap_open_extend; // open new gap
+    c[0]->D = deletion_score;
+    if(c[0]->D > G) 
+        G = c[0]->D; // new best score
+    
+    return(c[0]->G = G);
+}
 
-		if (c[0]->D > G) 
-            G = c[0]->D; // new best score
-	} 
+// Calculate the score of a deletion from the query
+// after the alignment of cell p
+int calculateDeletionScore(const LRParams& params, const LRCell* p)
+{
+    if(p->D > p->G - params.alnParams.gap_open)
+        return p->D - params.alnParams.gap_ext; // extend gap
     else
-    {
-        c[0]->D = MINUS_INF;
-    }
-    
-	return(c[0]->G = G);
+        return p->G - params.alnParams.gap_open_extend; // open new gap
 }
 
 // Remove duplicate hits to the same target sequence from the hits vector
@@ -139,6 +139,57 @@ struct LRStackEntry
 typedef std::stack<LRStackEntry*> LRStack;
 typedef std::vector<LRStackEntry*> LRPendingVector;
 
+// The intervals of the four children of a node
+// in the prefix trie of the target
+struct LRTargetChildren
+{
+    BWTInterval interval[4];
+};
+
+// Functors to use a BWTInterval as a hash key
+struct LRIntervalHash
+{
+    size_t operator()(const BWTInterval& a) const { return (size_t)a.lower * 31 + (size_t)a.upper; }
+};
+
+struct LRIntervalEqual
+{
+    bool operator()(const BWTInterval& a, const BWTInterval& b) const { return BWTInterval::equal(a, b); }
+};
+
+typedef HashMap<BWTInterval, LRTargetChildren, LRIntervalHash, LRIntervalEqual> LRTargetChildMap;
+
+// Storage that is reused between the alignments of a batch of queries.
+// The children of the nodes of the target prefix trie are cached, so
+// queries that align to the same region of the target, like the
+// haplotypes of a variant and their reverse complements, share
+// the traversal of the target BWT.
+class LRWorkspace
+{
+    public:
+        LRWorkspace(const BWT* pTargetBWT);
+        ~LRWorkspace();
+
+        // Returns the intervals of the children of the target node
+        LRTargetChildren getTargetChildren(const BWTInterval& interval);
+
+        // Stack entries are recycled so their cell arrays keep their capacity
+        LRStackEntry* createEntry();
+        void releaseEntry(LRStackEntry* entry);
+
+        // The state of the alignment of one query, emptied between queries
+        LRStack stack;
+        LRPendingVector pendingVector;
+        LRHash dawgHash;
+        LRHash dupHash;
+        IntVector deletionScores;
+
+    private:
+        const BWT* m_pTargetBWT;
+        LRTargetChildMap m_targetChildren;
+        LRPendingVector m_freeEntries;
+};
+
 // Core alignment function - align the sequence query 
 // against all sequences in pTargetBWT
 void bwaswAlignment(const std::string& query, 
@@ -147,6 +198,24 @@ void bwaswAlignment(const std::string& query,
                     const LRParams& params,
                     LRHitVector& outHits);
 
+// Align the sequence query using the storage in pWorkspace,
+// which must have been created for pTargetBWT
+void bwaswAlignment(const std::string& query, 
+                    const BWT* pTargetBWT, 
+                    const SampledSuffixArray* pTargetSSA,
+                    const LRParams& params,
+                    LRWorkspace* pWorkspace,
+                    LRHitVector& outHits);
+
+// Align each sequence in queries against all sequences in pTargetBWT.
+// The hits of queries[i] are appended to outHits[i]. The hits are the
+// same as aligning each query on its own but the queries share a workspace.
+void bwaswAlignmentBatch(const StringVector& queries, 
+                         const BWT* pTargetBWT, 
+                         const SampledSuffixArray* pTargetSSA,
+                         const LRParams& params,
+                         std::vector<LRHitVector>& outHits);
+
 //
 MultiAlignment convertHitsToMultiAlignment(const std::string& query, 
                                            const BWT* pTargetBWT, 
@@ -165,12 +234,10 @@ void initializeDAWGHash(BWT* pQueryBWT, LRHash& dawgHash);
 // Merge the cells of the two stack entries
 void mergeStackEntries(LRStackEntry* u, LRStackEntry* v);
 
-// Update the given LRStack to contain the new StackEntry after
+// Update the stack of the workspace to contain the new StackEntry after
 // performing any necessary merges with pending Stacks
-int updateStack(LRStack* pStack, 
+int updateStack(LRWorkspace* pWorkspace, 
                 LRStackEntry* u, 
-                LRPendingVector* pPendingVector, 
-                LRHash* pDawgHash, 
                 const LRParams& params);
 
 // Cull duplicated cells in the given stack entry
@@ -215,6 +282,13 @@ void saveTerminalHits(const SuffixArray* pQuerySA,
 // Using the cell points in c, calculate scores for cell c[0]
 int fillCells(const LRParams& params, int match_score, LRCell* c[4]);
 
+// As above, with the deletion score of c[2] already calculated.
+// c[2] is not used.
+int fillCells(const LRParams& params, int match_score, int deletion_score, LRCell* c[4]);
+
+// Calculate the score of extending the alignment of cell p by a deletion
+int calculateDeletionScore(const LRParams& params, const LRCell* p);
+
 // Functions to heuristically remove low-scoring cells
 void cutTail(LRStackEntry* u, const LRParams& params);
 void cutTailByScorePercent(LRStackEntry* u, const LRParams& params);
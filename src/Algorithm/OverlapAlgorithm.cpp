@@ -14,6 +14,12 @@ static const AlignFlags prePreAF(false, true, true);
 static const AlignFlags sufSufAF(true, false, true);
 static const AlignFlags preSufAF(true, true, false);
 
+// The number of seeds between a prefetch and the extension that uses it
+static const size_t SEED_PREFETCH_DISTANCE = 4;
+
+// The number of reads whose irreducible computation hit the step limit
+static size_t s_numAbortedIrreducible = 0;
+
 //#define DEBUGOVERLAP 1
 
 // Perform the overlap
@@ -57,7 +63,7 @@ OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int mi
     {
         if(m_bIrreducible)
         {
-            computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &obWorkingList, pOBOut);
+            valid = computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &obWorkingList, pOBOut);
             obWorkingList.clear();
         }
         else
@@ -82,7 +88,7 @@ OverlapResult OverlapAlgorithm::overlapReadInexact(const SeqRecord& read, int mi
     {
         if(m_bIrreducible)
         {
-            computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &obWorkingList, pOBOut);
+            valid = computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &obWorkingList, pOBOut);
             obWorkingList.clear();
         }
         else
@@ -176,8 +182,16 @@ OverlapResult OverlapAlgorithm::overlapReadExact(const SeqRecord& read, int minO
     // Filter out transitive overlap blocks if requested
     if(m_bIrreducible)
     {
-        computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &oblSuffixFwd, pOBOut);
-        computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &oblPrefixFwd, pOBOut);
+        bool valid = computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &oblSuffixFwd, pOBOut);
+        if(valid)
+            valid = computeIrreducibleBlocks(m_pBWT, m_pRevBWT, &oblPrefixFwd, pOBOut);
+
+        if(!valid)
+        {
+            pOBOut->clear();
+            result.isSubstring = false;
+            result.searchAborted = true;
+        }
     }
     else
     {
@@ -307,7 +321,6 @@ bool OverlapAlgorithm::findOverlapBlocksInexact(const std::string& w, const BWT*
     SearchSeedVector* pCurrVector = new SearchSeedVector;
     SearchSeedVector* pNextVector = new SearchSeedVector;
     OverlapBlockList workingList;
-    SearchSeedVector::iterator iter;
 
     // Create and extend the initial seeds
     int actual_seed_length = m_seedLength;
@@ -340,10 +353,21 @@ bool OverlapAlgorithm::findOverlapBlocksInexact(const std::string& w, const BWT*
             break;
         }
 
-        iter = pCurrVector->begin();
-        while(iter != pCurrVector->end())
+        // The seeds of a round are independent so the BWT lookups of the seeds
+        // ahead of the current one are prefetched in two stages, first the
+        // markers and then the symbols, which are found using the markers.
+        size_t num_seeds = pCurrVector->size();
+        for(size_t i = 0; i < num_seeds && i < SEED_PREFETCH_DISTANCE; ++i)
+            prefetchSeedExtension((*pCurrVector)[i], pBWT, pRevBWT, false);
+
+        for(size_t i = 0; i < num_seeds; ++i)
         {
-            SearchSeed& align = *iter;
+            if(i + 2 * SEED_PREFETCH_DISTANCE < num_seeds)
+                prefetchSeedExtension((*pCurrVector)[i + 2 * SEED_PREFETCH_DISTANCE], pBWT, pRevBWT, false);
+            if(i + SEED_PREFETCH_DISTANCE < num_seeds)
+                prefetchSeedExtension((*pCurrVector)[i + SEED_PREFETCH_DISTANCE], pBWT, pRevBWT, true);
+
+            SearchSeed& align = (*pCurrVector)[i];
 
             // If the current aligned region is right-terminal
             // and the overlap is greater than minOverlap, try to find overlaps
@@ -385,8 +409,6 @@ bool OverlapAlgorithm::findOverlapBlocksInexact(const std::string& w, const BWT*
                 extendSeedInexactRight(align, w, pBWT, pRevBWT, pNextVector);
             else
                 extendSeedInexactLeft(align, w, pBWT, pRevBWT, pNextVector);
-            ++iter;
-            //pCurrVector->erase(iter++);
         }
         pCurrVector->clear();
         assert(pCurrVector->empty());
@@ -586,6 +608,24 @@ void OverlapAlgorithm::extendSeedsExactRight(const std::string& w, const BWT* /*
     }
 }
 
+// Prefetch the parts of the BWT that are read by the next extension of the seed.
+// If symbols is false only the markers are prefetched.
+void OverlapAlgorithm::prefetchSeedExtension(const SearchSeed& seed, const BWT* pBWT, const BWT* pRevBWT, bool symbols) const
+{
+    const BWT* pExtBWT = seed.dir == ED_RIGHT ? pRevBWT : pBWT;
+    const BWTInterval& interval = seed.dir == ED_RIGHT ? seed.ranges.interval[1] : seed.ranges.interval[0];
+    if(symbols)
+    {
+        pExtBWT->prefetchSymbols(interval.lower - 1);
+        pExtBWT->prefetchSymbols(interval.upper);
+    }
+    else
+    {
+        pExtBWT->prefetchMarkers(interval.lower - 1);
+        pExtBWT->prefetchMarkers(interval.upper);
+    }
+}
+
 //
 void OverlapAlgorithm::extendSeedInexactRight(SearchSeed& seed, const std::string& w, const BWT* /*pBWT*/, 
                                               const BWT* pRevBWT, SearchSeedVector* pOutVector) const
@@ -722,36 +762,62 @@ bool OverlapAlgorithm::extendSeedExactLeft(SearchSeed& seed, const std::string&
 }
 
 // Calculate the irreducible blocks from the vector of OverlapBlocks
-void OverlapAlgorithm::computeIrreducibleBlocks(const BWT* pBWT, const BWT* pRevBWT, 
+// Returns false if the search was aborted at the step limit, in which
+// case pOBFinal is incomplete
+bool OverlapAlgorithm::computeIrreducibleBlocks(const BWT* pBWT, const BWT* pRevBWT, 
                                                 OverlapBlockList* pOBList, 
                                                 OverlapBlockList* pOBFinal) const
 {
     // processIrreducibleBlocks requires the pOBList to be sorted in descending order
     pOBList->sort(OverlapBlock::sortSizeDescending);
+    bool valid;
     if(m_exactModeIrreducible)
-        _processIrreducibleBlocksExactIterative(pBWT, pRevBWT, *pOBList, pOBFinal);
+        valid = _processIrreducibleBlocksExactIterative(pBWT, pRevBWT, *pOBList, pOBFinal);
     else
-        _processIrreducibleBlocksInexact(pBWT, pRevBWT, *pOBList, pOBFinal);
+        valid = _processIrreducibleBlocksInexact(pBWT, pRevBWT, *pOBList, pOBFinal);
     pOBList->clear();
+
+    if(!valid)
+        __sync_fetch_and_add(&s_numAbortedIrreducible, 1);
+    return valid;
 }
 
-// iterate through obList and determine the overlaps that are irreducible. This function is recursive.
+//
+bool OverlapAlgorithm::isIrreducibleLimitExceeded(size_t numSteps) const
+{
+    return m_maxIrreducibleSteps >= 0 && numSteps > (size_t)m_maxIrreducibleSteps;
+}
+
+//
+size_t OverlapAlgorithm::getNumAbortedIrreducible()
+{
+    return s_numAbortedIrreducible;
+}
+
+// iterate through obList and determine the overlaps that are irreducible.
 // The final overlap blocks corresponding to irreducible overlaps are written to pOBFinal.
+// The blocks of inList are moved into the working groups so inList is empty on return.
 // Invariant: the blocks are ordered in descending order of the overlap size so that the longest overlap is first.
 // Invariant: each block corresponds to the same extension of the root sequence w.
-void OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT, const BWT* pRevBWT, 
+bool OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT, const BWT* pRevBWT, 
                                                                OverlapBlockList& inList, 
                                                                OverlapBlockList* pOBFinal) const
 {
     if(inList.empty())
-        return;
+        return true;
     
     // We store the overlap blocks in groups of blocks that have the same right-extension.
-    // When a branch is found, the groups are split based on the extension
-    typedef std::list<OverlapBlockList> BlockGroups;
+    // When a branch is found, the groups are split based on the extension.
+    // The nodes of the groups come from the per-thread pool so the groups
+    // of successive reads reuse the same memory.
+    typedef std::list<OverlapBlockList, PoolAllocator<OverlapBlockList> > BlockGroups;
 
     BlockGroups blockGroups;
-    blockGroups.push_back(inList);
+    blockGroups.push_back(OverlapBlockList());
+    blockGroups.back().splice(blockGroups.back().end(), inList);
+
+    BlockGroups incomingGroups; // Branched blocks are placed here
+    size_t numSteps = 0;
     int numExtensions = 0;
     int numBranches = 0;
     while(!blockGroups.empty())
@@ -760,7 +826,6 @@ void OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT,
         // If the top-level block has ended, push the result
         // to the final list and remove the group from processing
         BlockGroups::iterator groupIter = blockGroups.begin();
-        BlockGroups incomingGroups; // Branched blocks are placed here
 
         while(groupIter != blockGroups.end())
         {
@@ -775,6 +840,7 @@ void OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT,
             {
                 ext_count += blockIter->getCanonicalExtCount(pBWT, pRevBWT);
                 ++blockIter;
+                ++numSteps;
             }
             
             // Three cases:
@@ -824,6 +890,7 @@ void OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT,
                 {
                     ext_count += blockIter->getCanonicalExtCount(pBWT, pRevBWT);
                     ++blockIter;
+                    ++numSteps;
                 }
 
                 if(ext_count.hasUniqueDNAChar())
@@ -837,15 +904,28 @@ void OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT,
                 }
                 else
                 {
+                    // The last branch takes the blocks of this group, 
+                    // the other branches are copies
+                    size_t lastIdx = 0;
+                    for(size_t idx = 0; idx < DNA_ALPHABET_SIZE; ++idx)
+                    {
+                        if(ext_count.get(ALPHABET[idx]) > 0)
+                            lastIdx = idx;
+                    }
+
                     for(size_t idx = 0; idx < DNA_ALPHABET_SIZE; ++idx)
                     {
                         char b = ALPHABET[idx];
                         if(ext_count.get(b) > 0)
                         {
                             numBranches++;
-                            OverlapBlockList branched = currList;
+                            incomingGroups.push_back(OverlapBlockList());
+                            OverlapBlockList& branched = incomingGroups.back();
+                            if(idx == lastIdx)
+                                branched.splice(branched.end(), currList);
+                            else
+                                branched = currList;
                             updateOverlapBlockRangesRight(pBWT, pRevBWT, branched, b);
-                            incomingGroups.push_back(branched);
                             bEraseGroup = true;
                         }
                     }
@@ -860,22 +940,28 @@ void OverlapAlgorithm::_processIrreducibleBlocksExactIterative(const BWT* pBWT,
 
         // Splice in the newly branched blocks, if any
         blockGroups.splice(blockGroups.end(), incomingGroups);
+
+        // Give up on reads that branch too much
+        if(isIrreducibleLimitExceeded(numSteps))
+            return false;
     }
+    return true;
 }
 
 // Classify the blocks in obList as irreducible, transitive or substrings. The irreducible blocks are
 // put into pOBFinal. The remaining are discarded.
 // Invariant: the blocks are ordered in descending order of the overlap size so that the longest overlap is first.
-void OverlapAlgorithm::_processIrreducibleBlocksInexact(const BWT* pBWT, const BWT* pRevBWT, 
+bool OverlapAlgorithm::_processIrreducibleBlocksInexact(const BWT* pBWT, const BWT* pRevBWT, 
                                                         OverlapBlockList& activeList, 
                                                         OverlapBlockList* pOBFinal) const
 {
     if(activeList.empty())
-        return;
+        return true;
     
     // The activeList contains all the blocks that are not yet right terminal
     // Count the extensions in the top level (longest) blocks first
     bool all_eliminated = false;
+    size_t numSteps = 0;
     while(!activeList.empty() && !all_eliminated)
     {
         // The terminalBlock list contains all the blocks that became right-terminal
@@ -885,7 +971,12 @@ void OverlapAlgorithm::_processIrreducibleBlocksInexact(const BWT* pBWT, const B
 
         // Perform a single round of extension, any terminal blocks
         // are moved to the terminated list
-        extendActiveBlocksRight(pBWT, pRevBWT, activeList, terminalList, potentialContainedList);
+        numSteps += extendActiveBlocksRight(pBWT, pRevBWT, activeList, terminalList, potentialContainedList);
+        if(isIrreducibleLimitExceeded(numSteps))
+        {
+            activeList.clear();
+            return false;
+        }
 
         // Compare the blocks in the contained list against the other terminal and active blocks
         // If they are a substring match to any of these, discard them
@@ -953,23 +1044,26 @@ void OverlapAlgorithm::_processIrreducibleBlocksInexact(const BWT* pBWT, const B
     }
 
     activeList.clear();
+    return true;
 }
 
 // Extend all the blocks in activeList by one base to the right
 // Move all right-terminal blocks to the termainl list. If a block 
 // is terminal and potentially contained by another block, add it to 
-// containedList
-void OverlapAlgorithm::extendActiveBlocksRight(const BWT* pBWT, const BWT* pRevBWT, 
+// containedList. Returns the number of blocks that were extended.
+size_t OverlapAlgorithm::extendActiveBlocksRight(const BWT* pBWT, const BWT* pRevBWT, 
                                                OverlapBlockList& activeList, 
                                                OverlapBlockList& terminalList,
                                                OverlapBlockList& /*containedList*/) const
 {
+    size_t numExtended = 0;
     OverlapBlockList::iterator iter = activeList.begin();
     OverlapBlockList::iterator next;
     while(iter != activeList.end())
     {
         next = iter;
         ++next;
+        ++numExtended;
 
         // Check if block is terminal
         AlphaCount64 ext_count = iter->getCanonicalExtCount(pBWT, pRevBWT);
@@ -1039,6 +1133,7 @@ void OverlapAlgorithm::extendActiveBlocksRight(const BWT* pBWT, const BWT* pRevB
 
         iter = next; // this skips the newly-inserted blocks
     }
+    return numExtended;
 } 
 
 // Return true if the terminalBlock is a substring of any member of blockList
@@ -43,7 +43,8 @@ class OverlapAlgorithm
                                          m_bIrreducible(irrOnly),
                                          m_exactModeOverlap(false),
                                          m_exactModeIrreducible(false),
-                                         m_maxSeeds(maxSeeds) {}
+                                         m_maxSeeds(maxSeeds),
+                                         m_maxIrreducibleSteps(-1) {}
 
         // Perform the overlap
         // This function is threaded so everything must be const
@@ -71,6 +72,13 @@ class OverlapAlgorithm
         void setExactModeOverlap(bool b) { m_exactModeOverlap = b; }
         void setExactModeIrreducible(bool b) { m_exactModeIrreducible = b; }
 
+        // Limit the number of block extensions performed when computing the irreducible
+        // overlaps of a read. Reads that exceed the limit have their search aborted.
+        void setMaxIrreducibleSteps(int n) { m_maxIrreducibleSteps = n; }
+
+        // Returns the number of reads whose irreducible computation was aborted at the step limit
+        static size_t getNumAbortedIrreducible();
+
         //
         const BWT* getBWT() const { return m_pBWT; }
         const BWT* getRBWT() const { return m_pRevBWT; }
@@ -95,6 +103,9 @@ class OverlapAlgorithm
         inline void branchSeedRight(const SearchSeed& seed, const std::string& w, const BWT* pBWT, const BWT* pRevBWT, SearchSeedQueue* pQueue) const;
         inline void branchSeedLeft(const SearchSeed& seed, const std::string& w, const BWT* pBWT, const BWT* pRevBWT, SearchSeedQueue* pQueue) const;
 
+        // Prefetch the BWT data read by the next extension of the seed
+        inline void prefetchSeedExtension(const SearchSeed& seed, const BWT* pBWT, const BWT* pRevBWT, bool symbols) const;
+
         //
         inline void extendSeedInexactRight(SearchSeed& seed, const std::string& w, const BWT* pBWT, const BWT* pRevBWT, 
                                            SearchSeedVector* pOutVector) const;
@@ -128,29 +139,29 @@ class OverlapAlgorithm
         //                    
         // Irreducible-only processing algorithms
         //
-        // Reduce the block list pOBList by removing blocks that correspond to transitive edges
-        void computeIrreducibleBlocks(const BWT* pBWT, const BWT* pRevBWT, 
+        // Reduce the block list pOBList by removing blocks that correspond to transitive edges.
+        // Returns false if the step limit was exceeded.
+        bool computeIrreducibleBlocks(const BWT* pBWT, const BWT* pRevBWT, 
                                       OverlapBlockList* pOBList, OverlapBlockList* pOBFinal) const;
         
-        // these recursive functions do the actual work of computing the irreducible blocks
-        void _processIrreducibleBlocksExact(const BWT* pBWT, const BWT* pRevBWT, 
-                                            OverlapBlockList& obList, OverlapBlockList* pOBFinal) const;
-
-
-        void _processIrreducibleBlocksExactIterative(const BWT* pBWT, 
+        // these functions do the actual work of computing the irreducible blocks
+        bool _processIrreducibleBlocksExactIterative(const BWT* pBWT, 
                                                      const BWT* pRevBWT, 
                                                      OverlapBlockList& inList, 
                                                      OverlapBlockList* pOBFinal) const;
         //
-        void _processIrreducibleBlocksInexact(const BWT* pBWT, const BWT* pRevBWT, 
+        bool _processIrreducibleBlocksInexact(const BWT* pBWT, const BWT* pRevBWT, 
                                               OverlapBlockList& obList, OverlapBlockList* pOBFinal) const;
 
+        // Returns true if numSteps is over the irreducible step limit
+        bool isIrreducibleLimitExceeded(size_t numSteps) const;
+
         // Update the overlap block list with a righthand extension to b, removing ranges that become invalid
         void updateOverlapBlockRangesRight(const BWT* pBWT, const BWT* pRevBWT, 
                                            OverlapBlockList& obList, char b) const;
          
-        //                                  
-        void extendActiveBlocksRight(const BWT* pBWT, const BWT* pRevBWT, 
+        // Returns the number of blocks that were extended
+        size_t extendActiveBlocksRight(const BWT* pBWT, const BWT* pRevBWT, 
                                      OverlapBlockList& activeList, 
                                      OverlapBlockList& terminalList,
                                      OverlapBlockList& containedList) const;
@@ -170,6 +181,9 @@ class OverlapAlgorithm
         
         // Optional parameter to limit the amount of branching that is performed
         int m_maxSeeds; 
+
+        // Optional parameter to limit the work of the irreducible block computation
+        int m_maxIrreducibleSteps;
 };
 
 #endif
@@ -18,6 +18,7 @@
 #include "SearchHistory.h"
 #include "GraphCommon.h"
 #include "MultiOverlap.h"
+#include "PoolAllocator.h"
 
 // Flags indicating how a given read was aligned to the FM-index
 // Used for internal bookkeeping
@@ -187,7 +188,9 @@ struct OverlapBlock
 };
 
 // Collections
-typedef std::list<OverlapBlock> OverlapBlockList;
+// The nodes of the lists are recycled through the pool of the thread as
+// the lists are built and emptied for every read
+typedef std::list<OverlapBlock, PoolAllocator<OverlapBlock> > OverlapBlockList;
 typedef OverlapBlockList::iterator OBLIter;
 
 // Global Functions
@@ -10,6 +10,7 @@
 #define SEARCHHISTORY_H
 
 #include "Util.h"
+#include "PoolAllocator.h"
 
 // Base, Position pair indicating a divergence during the search
 struct SearchHistoryItem
@@ -29,7 +30,9 @@ struct SearchHistoryItem
         return out;
     }
 };
-typedef std::vector<SearchHistoryItem> HistoryItemVector;
+// The histories of the overlap blocks are short, their storage
+// is recycled through the pool of the thread
+typedef std::vector<SearchHistoryItem, PoolAllocator<SearchHistoryItem> > HistoryItemVector;
 
 // A vector of history items that can be compared with other histories
 class SearchHistoryVector
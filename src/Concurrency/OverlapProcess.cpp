@@ -8,13 +8,85 @@
 //
 #include "OverlapProcess.h"
 
+//
+OverlapDuplicateCache::OverlapDuplicateCache() : m_numHits(0), m_numMisses(0)
+{
+    int ret = pthread_mutex_init(&m_mutex, NULL);
+    if(ret != 0)
+    {
+        std::cerr << "Mutex initialization failed with error " << ret << ", aborting" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+OverlapDuplicateCache::~OverlapDuplicateCache()
+{
+    int ret = pthread_mutex_destroy(&m_mutex);
+    if(ret != 0)
+    {
+        std::cerr << "Mutex destruction failed with error " << ret << ", aborting" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+bool OverlapDuplicateCache::lookup(const BWTInterval& readInterval, OverlapResult& result, OverlapBlockList* pOutList)
+{
+    bool found = false;
+    pthread_mutex_lock(&m_mutex);
+    CacheMap::iterator iter = m_map.find(readInterval);
+    if(iter != m_map.end())
+    {
+        found = true;
+        m_numHits += 1;
+        result = iter->second.result;
+        *pOutList = iter->second.blocks;
+        release(iter);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return found;
+}
+
+// The overlaps are computed outside of the lock so two workers can compute
+// copies of the same read at the same time. Only the first result is stored,
+// the second copy counts as a use of the stored entry.
+void OverlapDuplicateCache::insert(const BWTInterval& readInterval, const OverlapResult& result, const OverlapBlockList& blockList)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_numMisses += 1;
+    CacheMap::iterator iter = m_map.find(readInterval);
+    if(iter != m_map.end())
+    {
+        release(iter);
+    }
+    else
+    {
+        CacheEntry& entry = m_map[readInterval];
+        entry.result = result;
+        entry.blocks = blockList;
+        entry.numRemaining = readInterval.size() - 1;
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+// Must be called with the mutex held
+void OverlapDuplicateCache::release(CacheMap::iterator iter)
+{
+    iter->second.numRemaining -= 1;
+    if(iter->second.numRemaining <= 0)
+        m_map.erase(iter);
+}
+
 //
 //
 //
 OverlapProcess::OverlapProcess(const std::string& outFile, 
                                const OverlapAlgorithm* pOverlapper, 
-                               int minOverlap) : m_pOverlapper(pOverlapper), 
-                                                 m_minOverlap(minOverlap)
+                               int minOverlap,
+                               OverlapDuplicateCache* pDuplicateCache) : m_pOverlapper(pOverlapper), 
+                                                                         m_minOverlap(minOverlap),
+                                                                         m_pDuplicateCache(pDuplicateCache)
 {
     m_pWriter = createWriter(outFile);
 }
@@ -28,7 +100,28 @@ OverlapProcess::~OverlapProcess()
 //
 OverlapResult OverlapProcess::process(const SequenceWorkItem& workItem)
 {
-    OverlapResult result = m_pOverlapper->overlapRead(workItem.read, m_minOverlap, &m_blockList);
+    // The interval of read$ holds every read that ends with the read sequence.
+    // Extending it to $read$ leaves one entry for each copy of the read in the index.
+    BWTInterval readInterval;
+    if(m_pDuplicateCache != NULL)
+    {
+        const BWT* pBWT = m_pOverlapper->getBWT();
+        std::string w = workItem.read.seq.toString();
+        w.append(1, '$');
+        readInterval = BWTAlgorithms::findInterval(pBWT, w);
+        if(readInterval.isValid())
+            BWTAlgorithms::updateInterval(readInterval, '$', pBWT);
+    }
+
+    bool isDuplicated = readInterval.isValid() && readInterval.size() > 1;
+    OverlapResult result;
+    if(!isDuplicated || !m_pDuplicateCache->lookup(readInterval, result, &m_blockList))
+    {
+        result = m_pOverlapper->overlapRead(workItem.read, m_minOverlap, &m_blockList);
+        if(isDuplicated)
+            m_pDuplicateCache->insert(readInterval, result, m_blockList);
+    }
+
     m_pOverlapper->writeOverlapBlocks(*m_pWriter, workItem.idx, result.isSubstring, &m_blockList);
     m_blockList.clear();
     return result;
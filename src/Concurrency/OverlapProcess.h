@@ -9,17 +9,76 @@
 #ifndef OVERLAPPROCESS_H
 #define OVERLAPPROCESS_H
 
+#include <map>
+#include <pthread.h>
 #include "Util.h"
 #include "OverlapAlgorithm.h"
 #include "SequenceProcessFramework.h"
 
+// Cache of the overlaps of reads that have identical copies in the index.
+// Identical reads have the same overlaps so the result for the first copy
+// is reused for the others. The copies of a read share the interval of
+// $read$ in the BWT, which is used as the key. The cache is shared
+// by all the worker threads so every copy releases its entry, which is
+// removed once all the copies have used it.
+class OverlapDuplicateCache
+{
+    public:
+        OverlapDuplicateCache();
+        ~OverlapDuplicateCache();
+
+        // Copy the cached overlaps of the read with the given interval into
+        // result and pOutList. Returns false if they have not been cached.
+        bool lookup(const BWTInterval& readInterval, OverlapResult& result, OverlapBlockList* pOutList);
+
+        // Store the overlaps computed for a copy of the read with the given interval
+        void insert(const BWTInterval& readInterval, const OverlapResult& result, const OverlapBlockList& blockList);
+
+        // Returns the number of reads whose overlaps were taken from the
+        // cache and the number of reads that had to be computed
+        size_t getNumHits() const { return m_numHits; }
+        size_t getNumMisses() const { return m_numMisses; }
+
+        // Returns the number of entries that are waiting for more copies.
+        // This is zero once every read of the index has been processed.
+        size_t getNumEntries() const { return m_map.size(); }
+
+    private:
+
+        struct CacheEntry
+        {
+            OverlapResult result;
+            OverlapBlockList blocks;
+            int64_t numRemaining;
+        };
+
+        struct IntervalLess
+        {
+            bool operator()(const BWTInterval& a, const BWTInterval& b) const
+            {
+                return BWTInterval::compare(a, b);
+            }
+        };
+
+        typedef std::map<BWTInterval, CacheEntry, IntervalLess> CacheMap;
+
+        // Count one use of the entry, removing it when all the copies are done
+        void release(CacheMap::iterator iter);
+
+        CacheMap m_map;
+        size_t m_numHits;
+        size_t m_numMisses;
+        pthread_mutex_t m_mutex;
+};
+
 // Compute the overlap blocks for reads
 class OverlapProcess
 {
     public:
         OverlapProcess(const std::string& outFile, 
                        const OverlapAlgorithm* pOverlapper, 
-                       int minOverlap);
+                       int minOverlap,
+                       OverlapDuplicateCache* pDuplicateCache = NULL);
 
         ~OverlapProcess();
 
@@ -30,6 +89,9 @@ class OverlapProcess
         OverlapBlockList m_blockList;
         const OverlapAlgorithm* m_pOverlapper;
         const int m_minOverlap;
+
+        // Optional, shared between the processes
+        OverlapDuplicateCache* m_pDuplicateCache;
 };
 
 // Write the results from the overlap step to an ASQG file
@@ -34,3 +34,106 @@ OverlapResult RmdupProcess::process(const SequenceWorkItem& workItem)
     m_blockList.clear();
     return result;
 }
+
+//
+RmdupStreamProcess::RmdupStreamProcess(const OverlapAlgorithm* pOverlapper,
+                                       const SuffixArray* pFwdSAI,
+                                       const SuffixArray* pRevSAI,
+                                       const ReadInfoTable* pRIT) : m_pOverlapper(pOverlapper),
+                                                                    m_pFwdSAI(pFwdSAI),
+                                                                    m_pRevSAI(pRevSAI),
+                                                                    m_pRIT(pRIT)
+{
+
+}
+
+//
+RmdupResult RmdupStreamProcess::process(const SequenceWorkItem& workItem)
+{
+    RmdupResult result;
+    OverlapResult overlapResult = m_pOverlapper->alignReadDuplicate(workItem.read, &m_blockList);
+
+    // Every entry of the blocks is a copy of the read, including the read itself
+    for(OverlapBlockList::const_iterator iter = m_blockList.begin(); iter != m_blockList.end(); ++iter)
+    {
+        if(iter->ranges.interval[0].isValid())
+            result.numCopies += iter->ranges.interval[0].size();
+    }
+
+    result.isSubstring = overlapResult.isSubstring;
+    result.isDuplicate = !result.isSubstring && isContained(workItem.idx, m_blockList);
+    m_blockList.clear();
+    return result;
+}
+
+// Returns true if the read is contained by another read in the blocks.
+// When two reads are identical, the read with the lexographically lower
+// ID is the one that is kept. The IDs are the indices of the reads in 
+// the ReadInfoTable so all the copies of a read agree on the read to keep.
+bool RmdupStreamProcess::isContained(size_t readIdx, const OverlapBlockList& blockList) const
+{
+    const ReadInfo& queryInfo = m_pRIT->getReadInfo(readIdx);
+    for(OverlapBlockList::const_iterator iter = blockList.begin(); iter != blockList.end(); ++iter)
+    {
+        const SuffixArray* pCurrSAI = (iter->flags.isTargetRev()) ? m_pRevSAI : m_pFwdSAI;
+        for(int64_t j = iter->ranges.interval[0].lower; j <= iter->ranges.interval[0].upper; ++j)
+        {
+            const ReadInfo& targetInfo = m_pRIT->getReadInfo(pCurrSAI->get(j).getID());
+            if(queryInfo.id == targetInfo.id)
+                continue;
+
+            // Each pair of reads is only considered from the read with the
+            // higher ID and containments are only considered for the forward query
+            Overlap o = iter->toOverlap(queryInfo.id, targetInfo.id, queryInfo.length, targetInfo.length);
+            if(o.id[0] < o.id[1] || (o.match.isContainment() && iter->flags.isQueryRev()))
+                continue;
+
+            if(o.isContainment() && o.getContainedIdx() == 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+//
+RmdupStreamPostProcess::RmdupStreamPostProcess(std::ostream* pWriter, 
+                                               std::ostream* pDupWriter) : m_pWriter(pWriter),
+                                                                           m_pDupWriter(pDupWriter),
+                                                                           m_substringRemoved(0),
+                                                                           m_identicalRemoved(0),
+                                                                           m_kept(0)
+{
+
+}
+
+//
+void RmdupStreamPostProcess::process(const SequenceWorkItem& workItem, const RmdupResult& result)
+{
+    SeqItem item = {workItem.read.id, workItem.read.seq};
+    std::stringstream meta;
+    meta << item.id << " NumDuplicates=" << result.numCopies;
+
+    if(result.isSubstring || result.isDuplicate)
+    {
+        if(result.isSubstring)
+            ++m_substringRemoved;
+        else
+            ++m_identicalRemoved;
+
+        // The read's index in the sequence data base
+        // is needed when removing it from the FM-index.
+        // In the output fasta, we set the reads ID to be the index
+        // and record its old id in the fasta header.
+        std::stringstream newID;
+        newID << item.id << ",seqrank=" << workItem.idx;
+        item.id = newID.str();
+
+        // Write some metadata with the fasta record
+        item.write(*m_pDupWriter, meta.str());
+    }
+    else
+    {
+        ++m_kept;
+        item.write(*m_pWriter, meta.str());
+    }
+}
@@ -13,6 +13,8 @@
 #include "Util.h"
 #include "OverlapAlgorithm.h"
 #include "SequenceProcessFramework.h"
+#include "SuffixArray.h"
+#include "ReadInfoTable.h"
 
 // Compute the overlap blocks for reads
 class RmdupProcess
@@ -39,4 +41,57 @@ class RmdupPostProcess
         void process(const SequenceWorkItem& /*item*/, const OverlapResult& /*result*/) {}
 };
 
+// The duplicate status of a read
+struct RmdupResult
+{
+    RmdupResult() : isSubstring(false), isDuplicate(false), numCopies(0) {}
+
+    bool isSubstring;
+    bool isDuplicate;
+    size_t numCopies;
+};
+
+// Resolve whether each read is a duplicate directly from
+// its overlap blocks, without writing the blocks to a hits file.
+// The indices are only read so one instance can be given to each thread.
+class RmdupStreamProcess
+{
+    public:
+        RmdupStreamProcess(const OverlapAlgorithm* pOverlapper,
+                           const SuffixArray* pFwdSAI,
+                           const SuffixArray* pRevSAI,
+                           const ReadInfoTable* pRIT);
+
+        RmdupResult process(const SequenceWorkItem& item);
+
+    private:
+        bool isContained(size_t readIdx, const OverlapBlockList& blockList) const;
+
+        OverlapBlockList m_blockList;
+        const OverlapAlgorithm* m_pOverlapper;
+        const SuffixArray* m_pFwdSAI;
+        const SuffixArray* m_pRevSAI;
+        const ReadInfoTable* m_pRIT;
+};
+
+// Write the kept reads and the duplicates in their original order
+class RmdupStreamPostProcess
+{
+    public:
+        RmdupStreamPostProcess(std::ostream* pWriter, std::ostream* pDupWriter);
+
+        void process(const SequenceWorkItem& item, const RmdupResult& result);
+
+        size_t getNumSubstringRemoved() const { return m_substringRemoved; }
+        size_t getNumIdenticalRemoved() const { return m_identicalRemoved; }
+        size_t getNumKept() const { return m_kept; }
+
+    private:
+        std::ostream* m_pWriter;
+        std::ostream* m_pDupWriter;
+        size_t m_substringRemoved;
+        size_t m_identicalRemoved;
+        size_t m_kept;
+};
+
 #endif
@@ -27,9 +27,10 @@ const size_t BUFFER_SIZE = 1000;
 
 // Generic function to process n work items from a file. 
 // With the default value of -1, n becomes the largest value representable for
-// a size_t and all values will be read
+// a size_t and all values will be read. Progress messages are written to pLog,
+// which callers that write their results to stdout should redirect.
 template<class Input, class Output, class Generator, class Processor, class PostProcessor>
-size_t processWorkSerial(Generator& generator, Processor* pProcessor, PostProcessor* pPostProcessor, size_t n = -1)
+size_t processWorkSerial(Generator& generator, Processor* pProcessor, PostProcessor* pPostProcessor, size_t n = -1, FILE* pLog = stdout)
 {
     Timer timer("SequenceProcess", true);
     Input workItem;
@@ -43,14 +44,14 @@ size_t processWorkSerial(Generator& generator, Processor* pProcessor, PostProces
         
         pPostProcessor->process(workItem, output);
         if(generator.getNumConsumed() % 50000 == 0)
-            printf("[sga] Processed %zu sequences (%lfs elapsed)\n", generator.getNumConsumed(), timer.getElapsedWallTime());
+            fprintf(pLog, "[sga] Processed %zu sequences (%lfs elapsed)\n", generator.getNumConsumed(), timer.getElapsedWallTime());
     }
 
     assert(n == (size_t)-1 || generator.getNumConsumed() == n);
 
     //
     double proc_time_secs = timer.getElapsedWallTime();
-    printf("[sga::process] processed %zu sequences in %lfs (%lf sequences/s)\n", 
+    fprintf(pLog, "[sga::process] processed %zu sequences in %lfs (%lf sequences/s)\n", 
             generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);    
     
     return generator.getNumConsumed();
@@ -96,13 +97,16 @@ size_t processSequencesSerial(const std::string& readsFile, Processor* pProcesso
 // which run the actual processing independently. An optional post processor
 // can be specified to process the results that the threads return. If the n
 // parameter is used, at most n sequences will be read from the file.
+// The post processor always sees the work items in the order they were
+// generated so the output is identical to the serial version.
 // 
 // This version is based on pthreads.
 template<class Input, class Output, class Generator, class Processor, class PostProcessor>
 size_t processWorkParallelPthread(Generator& generator, 
                                   std::vector<Processor*> processPtrVector, 
                                   PostProcessor* pPostProcessor, 
-                                  size_t n = -1)
+                                  size_t n = -1,
+                                  FILE* pLog = stdout)
 {
     Timer timer("SequenceProcess", true);
 
@@ -208,7 +212,7 @@ size_t processWorkParallelPthread(Generator& generator,
 
                 double proc_time_secs = timer.getElapsedWallTime();
                 if(generator.getNumConsumed() % (10 * BUFFER_SIZE * numThreads) == 0)
-                    printf("[sga] Processed %zu sequences in %lfs (%lf sequences/s)\n", generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);
+                    fprintf(pLog, "[sga] Processed %zu sequences in %lfs (%lf sequences/s)\n", generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);
 
                 // This should never loop more than twice
                 assert(numLoops < 2);
@@ -236,7 +240,7 @@ size_t processWorkParallelPthread(Generator& generator,
     assert(numWorkItemsRead == numWorkItemsWrote);
 
     double proc_time_secs = timer.getElapsedWallTime();
-    printf("[sga::process] processed %zu sequences in %lfs (%lf sequences/s)\n", 
+    fprintf(pLog, "[sga::process] processed %zu sequences in %lfs (%lf sequences/s)\n", 
             generator.getNumConsumed(), proc_time_secs, (double)generator.getNumConsumed() / proc_time_secs);
     return generator.getNumConsumed();
 }
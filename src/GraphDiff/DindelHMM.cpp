@@ -44,7 +44,9 @@ char complement(char b) { return b;}
 #endif
 
 
-DindelHMM::DindelHMM(DindelRead & read, const DindelMultiHaplotype & haplotype) : m_pRead(&read), m_pHaplotype(& haplotype)
+DindelHMM::DindelHMM(DindelRead & read, const DindelMultiHaplotype & haplotype, bool bSinglePrecision) : m_pRead(&read), 
+                                                                                                         m_pHaplotype(& haplotype), 
+                                                                                                         m_bSinglePrecision(bSinglePrecision)
 {
         
 	if (DINDEL_DEBUG) std::cerr << "CALLED DindelHMM::DindelHMM " << std::endl;
@@ -152,7 +154,9 @@ ReadHaplotypeAlignment DindelHMM::getAlignment()
     for (std::set<int>::const_iterator iter = positions.begin(); iter != positions.end(); iter++)
     {
         int hFirstBase = *iter-DINDEL_HMM_BANDWIDTH/2;
-        ReadHaplotypeAlignment rha = DindelHMMForward<DINDEL_HMM_BANDWIDTH>(m_pRead, m_pHaplotype, hFirstBase, rcRead);
+        ReadHaplotypeAlignment rha = m_bSinglePrecision ? 
+                                        DindelHMMForwardFloat<DINDEL_HMM_BANDWIDTH>(m_pRead, m_pHaplotype, hFirstBase, rcRead) :
+                                        DindelHMMForward<DINDEL_HMM_BANDWIDTH>(m_pRead, m_pHaplotype, hFirstBase, rcRead);
         if (rha.logLik>max_ll)
         {
             best = rha;
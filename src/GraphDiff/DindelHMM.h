@@ -11,6 +11,7 @@
 //
 #ifndef DINDELHMM_H
 #define	DINDELHMM_H
+#include <float.h>
 #include "DindelRealignWindow.h"
 
 const int DEBUGDINDELHMM=0;
@@ -22,7 +23,9 @@ class DindelHMM
     public:
 
         // Constructor
-        DindelHMM(DindelRead & read, const DindelMultiHaplotype & haplotype);
+        // If bSinglePrecision is true the forward pass is computed
+        // by DindelHMMForwardFloat instead of DindelHMMForward
+        DindelHMM(DindelRead & read, const DindelMultiHaplotype & haplotype, bool bSinglePrecision = false);
 
         // Functions
         ReadHaplotypeAlignment getAlignment();
@@ -35,6 +38,7 @@ class DindelHMM
         // Data
         DindelRead* m_pRead;
         const DindelMultiHaplotype * m_pHaplotype;
+        bool m_bSinglePrecision;
 };
 
 template<int BandWidth> ReadHaplotypeAlignment DindelHMMForward(const DindelRead * pRead, 
@@ -255,6 +259,229 @@ template<int BandWidth> ReadHaplotypeAlignment DindelHMMForward(const DindelRead
 	return rha;
 }
 
+// Lookup table of the probability that a base with a given phred
+// quality was called correctly, used by DindelHMMForwardFloat
+struct DindelHMMQualityTable
+{
+    static const int MAX_QUAL = 128;
+
+    DindelHMMQualityTable()
+    {
+        for (int q=0;q<MAX_QUAL;q++)
+            pr[q] = 1.0f - expf((-2.3026f/10.0f)*float(q));
+    }
+
+    float getProbCorrect(int q) const
+    {
+        if (q>=0 && q<MAX_QUAL)
+            return pr[q];
+        return 1.0f - expf((-2.3026f/10.0f)*float(q));
+    }
+
+    float pr[MAX_QUAL];
+};
+
+// Single precision version of DindelHMMForward. The band is held in
+// fixed-size float arrays so that the transition loops compile to packed
+// SIMD arithmetic, the base quality probabilities are looked up rather than
+// computed with exp() and the per-base log of the normalizing constant is
+// replaced by a running product of the constants that is only folded into
+// the log-likelihood when it approaches the bottom of the float range.
+// If the normalizing constant leaves the float range the alignment is
+// recomputed by DindelHMMForward. Otherwise the log-likelihood agrees with
+// DindelHMMForward to within float rounding.
+template<int BandWidth> ReadHaplotypeAlignment DindelHMMForwardFloat(const DindelRead * pRead, 
+                                                                     const DindelMultiHaplotype * pHaplotype, 
+                                                                     int hFirstBase, 
+                                                                     bool rcRead)
+{
+	const float hp[] = { 2.9e-5f, 2.9e-5f, 2.9e-5f, 2.9e-5f, 4.3e-5f, 1.1e-4f, 2.4e-4f, 5.7e-4f, 1.0e-3f, 1.4e-3f };
+	const int MAXHP = 10;
+
+	const float GAP_EXT = 0.5f;
+	const float GAP_STOP = 1.0f - GAP_EXT;
+
+	static const DindelHMMQualityTable qualityTable;
+
+	// Fold the running scale into the log-likelihood once it drops below this.
+	// Each factor is bounded well above 1e-20 so the product cannot underflow
+	const float MIN_SCALE = 1e-20f;
+
+	int rlen = pRead->length();
+	int hlen = pHaplotype->length();
+
+	const std::string & hapSeq = pHaplotype->getSequence();
+
+	float bufA[BandWidth*2];
+	float bufB[BandWidth*2];
+	float *curr = bufA;
+	float *next = bufB;
+	float obs[BandWidth];
+	float gap_prob[BandWidth];
+
+	// initialize curr to ones
+	for (int x=0;x<BandWidth*2;x++) 
+	{
+		curr[x]=1.0f; // NOTE NOT in log domain
+		next[x]=0.0f;
+	}
+
+	double norm=0.0;
+	float scale=1.0f;
+	for (int l=0;l<rlen;l++)
+	{
+		int readBaseIndex = (!rcRead)?l:(rlen-1-l);
+		char rb = (!rcRead)?pRead->getBase(readBaseIndex):complement(pRead->getBase(readBaseIndex));
+
+		// probabilities of correctly and incorrectly observing the read base
+		float pr=qualityTable.getProbCorrect(pRead->getQual(readBaseIndex));
+		float p_base_correct = (.25f+.75f*pr);
+		float p_base_incorrect =(.75f+1e-10f-.75f*pr);
+
+		// lower and upper haplotype position for this read base
+		int sb = 0;		// start in band
+		int eb = BandWidth-1;   // end in band (inclusive)
+		int lh = hFirstBase+l; // start base on haplotype
+		if (lh<0)
+		{
+			sb=-lh;
+			lh=0;
+		}
+
+		if (sb>=BandWidth && l<rlen-1) 
+		{
+			// this is left of the haplotype, the base is assumed to match
+			scale *= p_base_correct;
+			if (scale<MIN_SCALE)
+			{
+				norm += log(double(scale));
+				scale = 1.0f;
+			}
+			continue;
+		}
+
+		int uh = lh+BandWidth;
+		if (uh>=hlen)
+		{
+			eb=BandWidth-(1+uh-hlen);
+			if (eb<-1) eb=-1;
+			uh=hlen-1;              // both are inclusive
+		}
+
+		if (sb>=BandWidth) sb=BandWidth;
+
+		// set observations and gap_prob
+		for (int x=0;x<sb;++x)
+		{
+			obs[x] = p_base_correct;
+			gap_prob[x] = hp[0]/2.0f;
+		}
+		for (int x=eb+1;x<BandWidth;++x)
+		{
+			obs[x] = p_base_correct;
+			gap_prob[x] = hp[0]/2.0f;
+		}
+
+		int h=lh;
+		for (int x=sb;x<=eb;++x,++h)
+		{
+			obs[x] = (hapSeq[h]==rb)?p_base_correct:p_base_incorrect;
+			int hplen = pHaplotype->getHomopolymerLength(h);
+			float prob;
+			if (hplen<MAXHP) prob=hp[hplen]; else
+			{
+				prob=hp[9]+4.3e-4f*float(hplen-10);
+				if (prob>0.95f) prob=0.95f;
+			}
+			gap_prob[x]=prob/2.0f;
+		}
+
+		// UPDATES
+		if (l<rlen-1)
+		{
+			// INSERTION <= INSERTION
+			for (int x=1;x<BandWidth;++x) next[BandWidth+x-1] += GAP_EXT*curr[BandWidth+x]*p_base_correct;
+
+			// INSERTION <= NO_INSERTION
+			for (int x=1;x<BandWidth;++x) next[x-1] += gap_prob[x]*curr[x+BandWidth]*p_base_correct;
+
+			// PREMULTIPLY curr and obs
+			for (int x=0;x<BandWidth;++x) curr[x]*=obs[x];
+
+			// NO_INSERTION <= INSERTION
+			for (int x=0;x<BandWidth;++x) next[BandWidth+x] += GAP_STOP*curr[x];
+
+			// NO_INSERTION <= NO_INSERTION
+			for (int x=0;x<BandWidth;++x) next[x] += (1.0f-2.0f*gap_prob[x])*curr[x]; // this is the no-indel transition
+			for (int x=0;x<BandWidth-1;++x) next[x+1] += 0.632333f*gap_prob[x]*curr[x]; // deletion of 1
+			for (int x=0;x<BandWidth-2;++x) next[x+2] += 0.232622f*gap_prob[x]*curr[x];
+			for (int x=0;x<BandWidth-3;++x) next[x+3] += 0.085577f*gap_prob[x]*curr[x];
+			for (int x=0;x<BandWidth-4;++x) next[x+4] += 0.031482f*gap_prob[x]*curr[x];
+			for (int x=0;x<BandWidth-5;++x) next[x+5] += 0.011582f*gap_prob[x]*curr[x];
+			for (int x=0;x<BandWidth-6;++x) next[x+6] += 0.004261f*gap_prob[x]*curr[x];
+			for (int x=0;x<BandWidth-7;++x) next[x+7] += 0.001567f*gap_prob[x]*curr[x];
+			for (int x=0;x<BandWidth-8;++x) next[x+8] += 0.000577f*gap_prob[x]*curr[x];
+		}
+		else
+		{
+			// add prior and observations for last locus
+			for (int x=0;x<BandWidth;x++) next[x] = curr[x]*obs[x]*(1.0f-2.0f*gap_prob[x])/float(BandWidth);
+			for (int x=0;x<BandWidth;x++) next[x+BandWidth] = curr[x+BandWidth]*p_base_correct*gap_prob[x]/float(BandWidth);
+		}
+
+		// normalize
+		float sum=0.0f;
+		for (int x=0;x<BandWidth*2;x++) sum += next[x];
+
+		// out of the range of single precision, use the double version
+		if (!(sum>0.0f && sum<FLT_MAX))
+			return DindelHMMForward<BandWidth>(pRead, pHaplotype, hFirstBase, rcRead);
+
+		scale *= sum;
+		if (scale<MIN_SCALE)
+		{
+			norm += log(double(scale));
+			scale = 1.0f;
+		}
+
+		float inv_sum = 1.0f/sum;
+		for (int x=0;x<BandWidth*2;x++)
+		{
+			float v = next[x]*inv_sum;
+			next[x] = (v<1e-10f)?1e-10f:v; // introduces small rounding error....
+			curr[x]=0.0f; // note curr will be swapped with next below
+		}
+
+		// flip next and curr
+		float *tmp = next;
+		next = curr;
+		curr = tmp;
+	} // end forward passes
+
+	norm += log(double(scale));
+
+	// check if there is a state that has posterior >0.95
+	float postProb = -1.0f;
+	int state = -1;
+	for (int x=0;x<BandWidth;x++) 
+	{
+		if (curr[x]>postProb)
+		{
+			postProb=curr[x];
+			state=x;
+		}
+	}
+	int hapPosLastReadBase = (state!=-1)?(hFirstBase+rlen-1+state):-1;
+
+	assert(norm<0.0);
+
+	ReadHaplotypeAlignment rha;
+	rha.logLik = norm;
+	rha.postProbLastReadBase = postProb;
+	rha.hapPosLastReadBase=hapPosLastReadBase;
+	return rha;
+}
+
 ReadHaplotypeAlignment DindelHMMForward(const DindelRead & read, 
                                         const DindelHaplotype & haplotype, 
                                         int hFirstBase, 
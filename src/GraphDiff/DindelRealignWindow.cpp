@@ -37,6 +37,7 @@
 #include "HapgenUtil.h"
 #include "Quality.h"
 #include <cmath>
+#include <pthread.h>
 
 const int DINDEL_DEBUG=0;
 const int QUIET=1;
@@ -1978,7 +1979,7 @@ void DindelRealignWindow::HMMAlignReadAgainstHaplotypes(size_t readIndex, size_t
         }
         else
         {
-            DindelHMM hmm(read, haplotype);
+            DindelHMM hmm(read, haplotype, realignParameters.hmmSinglePrecision == 1);
             rha_hmm = hmm.getAlignment();
             hmm_alignment_cache[cache_key.str()] = rha_hmm;
         }
@@ -2033,10 +2034,57 @@ void DindelRealignWindow::computeReadHaplotypeAlignmentsUsingHMM(size_t firstHap
             hapReadAlignments.push_back( std::vector<ReadHaplotypeAlignment>(m_pDindelReads->size(), ReadHaplotypeAlignment(realignParameters.minLogLikAlignToAlt,-1)));
     }
     
-    // We cache the results of the HMM alignment to save time when the read set contains many duplicate reads (like 1000 genomes).
-    HashMap<std::string, ReadHaplotypeAlignment> hmm_alignment_cache;
+    // Large windows are split across threads. The number of read-haplotype
+    // pairs must be large enough to pay for starting the threads.
+    const size_t MIN_PARALLEL_PAIRS = 512;
+    size_t numReads = m_pDindelReads->size();
+    size_t numPairs = numReads * (lastHap - firstHap + 1);
+    int numThreads = realignParameters.hmmThreads;
+    if(numThreads > 1 && numPairs >= MIN_PARALLEL_PAIRS && !DINDEL_DEBUG)
+    {
+        HMMAlignWork work;
+        work.pWindow = this;
+        work.firstHap = firstHap;
+        work.lastHap = lastHap;
+        work.nextRead = 0;
+
+        std::vector<pthread_t> threads(numThreads - 1);
+        for(size_t i = 0; i < threads.size(); ++i)
+        {
+            int ret = pthread_create(&threads[i], 0, &DindelRealignWindow::HMMAlignThread, &work);
+            if(ret != 0)
+            {
+                std::cerr << "Thread creation failed with error " << ret << ", aborting" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // The calling thread takes a share of the work
+        HMMAlignThread(&work);
 
-    for (size_t r=0;r<m_pDindelReads->size();r++)
+        for(size_t i = 0; i < threads.size(); ++i)
+        {
+            int ret = pthread_join(threads[i], NULL);
+            if(ret != 0)
+            {
+                std::cerr << "Thread join failed with error " << ret << ", aborting" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    else
+    {
+        // We cache the results of the HMM alignment to save time when the read set contains many duplicate reads (like 1000 genomes).
+        HashMap<std::string, ReadHaplotypeAlignment> hmm_alignment_cache;
+        HMMAlignReads(0, numReads, firstHap, lastHap, hmm_alignment_cache);
+    }
+}
+
+// Align reads [firstRead, lastRead) against haplotypes [firstHap, lastHap]
+void DindelRealignWindow::HMMAlignReads(size_t firstRead, size_t lastRead, size_t firstHap, size_t lastHap,
+                                        HashMap<std::string, ReadHaplotypeAlignment>& hmm_alignment_cache)
+{
+    for (size_t r=firstRead;r<lastRead;r++)
     {
         const DindelRead & read = (*m_pDindelReads)[r];
         if  (DINDEL_DEBUG) std::cout << "\n*****\nDindelRealignWindow::computeReadHaplotypeAlignmentsUsingHMM reads[" << r << "]: " << read.getID() << std::endl;
@@ -2049,6 +2097,29 @@ void DindelRealignWindow::computeReadHaplotypeAlignmentsUsingHMM(size_t firstHap
     }
 }
 
+// Thread entry point for computeReadHaplotypeAlignmentsUsingHMM
+void* DindelRealignWindow::HMMAlignThread(void* pArg)
+{
+    HMMAlignWork* pWork = static_cast<HMMAlignWork*>(pArg);
+    DindelRealignWindow* pWindow = pWork->pWindow;
+    size_t numReads = pWindow->m_pDindelReads->size();
+
+    // Reads are handed out in small blocks so threads stay balanced
+    // when some reads take much longer to align than others. Each thread
+    // has its own alignment cache.
+    const size_t BLOCK_SIZE = 8;
+    HashMap<std::string, ReadHaplotypeAlignment> hmm_alignment_cache;
+    while(1)
+    {
+        size_t firstRead = __sync_fetch_and_add(&pWork->nextRead, BLOCK_SIZE);
+        if(firstRead >= numReads)
+            break;
+        size_t lastRead = std::min(firstRead + BLOCK_SIZE, numReads);
+        pWindow->HMMAlignReads(firstRead, lastRead, pWork->firstHap, pWork->lastHap, hmm_alignment_cache);
+    }
+    return NULL;
+}
+
 double DindelRealignWindow::getHaplotypePrior(const DindelHaplotype & h1, const DindelHaplotype & h2) const
 {
    const std::vector<DindelVariant> & v1 = h1.getVariants();
@@ -4751,7 +4822,7 @@ std::string DindelRealignParameters::getDefaultParameters() const
 {
      std::string paramString = "genotyping:0,maxNumReads:100000,maxNumReadsWindow:100000,showCallReads:0,minNumHaplotypeOverlaps:0,maxNumCandidatesPerWindow:32,windowReadBuffer:500,minVariantSep:10,haplotypeWidth:60,minCandidateAlleleCount:0,probSNP:0.001,probINDEL:0.0001,probMNP:0.00001";
      paramString += ",maxMappingQuality:80,addSNPMaxSNPs:0,addSNPMaxMismatches:3,addSNPMinMappingQual:30,addSNPMinBaseQual:20,addSNPMinCount:2,minPostProbLastReadBaseForUngapped:0.95";
-     paramString += ",singleSampleHetThreshold:20,singleSampleHomThreshold:20,EMtol:0.0001,EMmaxiter:200,doEM:1,realignMatePairs:0,multiSample:0,priorAddHaplotype:0.0001,graphDiffStyle:1";
+     paramString += ",singleSampleHetThreshold:20,singleSampleHomThreshold:20,EMtol:0.0001,EMmaxiter:200,doEM:1,realignMatePairs:0,multiSample:0,priorAddHaplotype:0.0001,graphDiffStyle:1,hmmSinglePrecision:0,hmmThreads:1";
      return paramString; 
 }      
 
@@ -4794,6 +4865,8 @@ void DindelRealignParameters::checkAndInit()
     os << ",multiSample:" << int(multiSample);
     os << ",priorAddHaplotype:" << exp(logPriorAddHaplotype);
     os << ",graphDiffStyle:" << int(graphDiffStyle);
+    os << ",hmmSinglePrecision:" << int(hmmSinglePrecision);
+    os << ",hmmThreads:" << int(hmmThreads);
     if (print) 
     {
         std::cout << "Realignment parameters:\n";
@@ -4872,6 +4945,8 @@ void DindelRealignParameters::initFromString(const std::string& paramString)
             else if (k == "multiSample") { if (!from_string<int>(multiSample,0, 1, v, std::dec)) fail = true; }
             else if (k == "priorAddHaplotype")  { double tmp; if (!from_string<double>(tmp,1e-10, 1.0, v, std::dec)) fail = true; else logPriorAddHaplotype=log(tmp); }
             else if (k == "graphDiffStyle")  { if (!from_string<int>(graphDiffStyle,0, 1, v, std::dec)) fail = true; }
+            else if (k == "hmmSinglePrecision")  { if (!from_string<int>(hmmSinglePrecision,0, 1, v, std::dec)) fail = true; }
+            else if (k == "hmmThreads")  { if (!from_string<int>(hmmThreads,1, 256, v, std::dec)) fail = true; }
             else throw std::string("Unrecognized parameter: "+k);
 
             if (fail) throw std::string("Cannot determine value for parameter " + k + " from "+v);
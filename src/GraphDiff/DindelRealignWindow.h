@@ -896,6 +896,8 @@ class DindelRealignParameters
         int realignMatePairs; // compute a joint likelihood for the alignment of a read pair to the candidate haplotype
         int multiSample;
         int graphDiffStyle; // determines way haplotypes are called in the tumour/child sample
+        int hmmSinglePrecision; // use the single precision forward pass of the HMM
+        int hmmThreads; // number of threads used to fill the read-haplotype likelihoods of large windows
 };
 
 // Realigns reads in a given window.
@@ -965,6 +967,21 @@ class DindelRealignWindow
                                            const std::vector<double> & lpError,
                                            HashMap<std::string, ReadHaplotypeAlignment>& hmm_alignment_cache);
 
+        // Shared state of the threads filling hapReadAlignments. Each thread
+        // takes blocks of reads from nextRead and aligns them against
+        // haplotypes [firstHap, lastHap], so every cell is written by exactly one thread.
+        struct HMMAlignWork
+        {
+            DindelRealignWindow* pWindow;
+            size_t firstHap;
+            size_t lastHap;
+            size_t nextRead;
+        };
+
+        void HMMAlignReads(size_t firstRead, size_t lastRead, size_t firstHap, size_t lastHap,
+                           HashMap<std::string, ReadHaplotypeAlignment>& hmm_alignment_cache);
+        static void* HMMAlignThread(void* pArg);
+
         // HAPLOTYPE FREQUENCY ESTIMATION BUSINESS
 
         // haplotype frequencies
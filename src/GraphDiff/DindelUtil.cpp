@@ -383,8 +383,7 @@ DindelReturnCode DindelUtil::computeBestAlignment(const StringVector& inHaplotyp
     // Align the haplotypes to the reference genome to generate candidate alignments
     //
     HapgenAlignmentVector candidateAlignments;
-    for(size_t i = 0; i < inHaplotypes.size(); ++i)
-        HapgenUtil::alignHaplotypeToReferenceBWASW(inHaplotypes[i], parameters.referenceIndex, candidateAlignments);
+    HapgenUtil::alignHaplotypesToReferenceBWASW(inHaplotypes, parameters.referenceIndex, candidateAlignments);
 
     // Remove duplicate or bad alignment pairs
     HapgenUtil::coalesceAlignments(candidateAlignments);
@@ -20,27 +20,46 @@
 void HapgenUtil::alignHaplotypeToReferenceBWASW(const std::string& haplotype,
                                                 const BWTIndexSet& referenceIndex,
                                                 HapgenAlignmentVector& outAlignments)
+{
+    alignHaplotypesToReferenceBWASW(StringVector(1, haplotype), referenceIndex, outAlignments);
+}
+
+// Align the haplotypes to the reference genome represented by the BWT/SSA pair.
+// Both strands of all the haplotypes are aligned as one batch so the alignments
+// share the traversal of the reference.
+void HapgenUtil::alignHaplotypesToReferenceBWASW(const StringVector& haplotypes,
+                                                 const BWTIndexSet& referenceIndex,
+                                                 HapgenAlignmentVector& outAlignments)
 {
     PROFILE_FUNC("HapgenUtil::alignHaplotypesToReferenceBWASW")
     LRAlignment::LRParams params;
 
     params.zBest = 20;
 
-    for(size_t i = 0; i <= 1; ++i)
+    // The forward and reverse complement strands of haplotype j are queries 2j and 2j + 1
+    StringVector queries;
+    for(size_t j = 0; j < haplotypes.size(); ++j)
     {
-        LRAlignment::LRHitVector hits;
-        std::string query = (i == 0) ? haplotype : reverseComplement(haplotype);
-        LRAlignment::bwaswAlignment(query, referenceIndex.pBWT, referenceIndex.pSSA, params, hits);
+        queries.push_back(haplotypes[j]);
+        queries.push_back(reverseComplement(haplotypes[j]));
+    }
+
+    std::vector<LRAlignment::LRHitVector> hits;
+    LRAlignment::bwaswAlignmentBatch(queries, referenceIndex.pBWT, referenceIndex.pSSA, params, hits);
 
-        // Convert the hits into alignments
-        for(size_t j = 0; j < hits.size(); ++j)
+    // Convert the hits into alignments
+    for(size_t i = 0; i < queries.size(); ++i)
+    {
+        const std::string& haplotype = haplotypes[i / 2];
+        bool is_reverse = i % 2 == 1;
+        for(size_t j = 0; j < hits[i].size(); ++j)
         {
-            int q_alignment_length = hits[j].q_end - hits[j].q_start;
+            int q_alignment_length = hits[i][j].q_end - hits[i][j].q_start;
 
             // Skip non-complete alignments
             if((int)haplotype.length() == q_alignment_length)
             {
-                HapgenAlignment aln(hits[j].targetID, hits[j].t_start, hits[j].length, hits[j].G, i == 1);
+                HapgenAlignment aln(hits[i][j].targetID, hits[i][j].t_start, hits[i][j].length, hits[i][j].G, is_reverse);
                 outAlignments.push_back(aln);
             }
         }
@@ -65,6 +65,11 @@ namespace HapgenUtil
                                         const BWTIndexSet& referenceIndex,
                                         HapgenAlignmentVector& outAlignments);
 
+    // Align all the haplotypes to the reference genome in one batch
+    void alignHaplotypesToReferenceBWASW(const StringVector& haplotypes,
+                                         const BWTIndexSet& referenceIndex,
+                                         HapgenAlignmentVector& outAlignments);
+
     //
     void alignHaplotypeToReferenceKmer(size_t k,
                                        const std::string& haplotype,
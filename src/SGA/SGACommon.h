@@ -26,6 +26,9 @@
 #define RSAI_EXT ".rsai"
 #define SSA_EXT ".ssa"
 #define POPIDX_EXT ".popidx"
+#define POPCOLOR_EXT ".popcolor"
+#define POPDEPTH_EXT ".popdepth"
+#define KEPT_EXT ".kept"
 
 // Default values
 #define DEFAULT_MIN_OVERLAP 45
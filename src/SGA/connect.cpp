@@ -33,6 +33,102 @@
 
 // Structs
 
+// A pair of primary alignments read from the BAM file, with
+// the vertices of the graph the reads are aligned to and
+// the parameters of the search between them
+struct ConnectPairItem
+{
+    SeqRecord read1;
+    SeqRecord read2;
+
+    Vertex* pX;
+    Vertex* pY;
+    EdgeDir walkDirectionXOut;
+    EdgeDir walkDirectionYIn;
+    int fromX;
+    int toY;
+    int maxWalkDistance;
+};
+
+// The walks found between a pair and the fragment
+// sequences they imply
+struct ConnectPairResult
+{
+    SGWalkVector walks;
+    StringVector fragments;
+};
+
+// Statistics of the connect run
+struct ConnectStats
+{
+    ConnectStats() : numPairsAttempted(0), numPairsResolved(0), numUnresolvedWrote(0),
+                     numFailedNoPath(0), numFailedMultiPaths(0), numFailedUnaligned(0),
+                     numPathsRejectLow(0), numPathsRejectHigh(0), numPathsRejectOrientation(0) {}
+
+    int numPairsAttempted;
+    int numPairsResolved;
+    int numUnresolvedWrote;
+    int numFailedNoPath;
+    int numFailedMultiPaths;
+    int numFailedUnaligned;
+    int numPathsRejectLow;
+    int numPathsRejectHigh;
+    int numPathsRejectOrientation;
+};
+
+// Read pairs of primary alignments from the BAM file. Pairs
+// where either read is unaligned are counted and skipped.
+class ConnectPairGenerator
+{
+    public:
+        ConnectPairGenerator(BamTools::BamReader* pBamReader, 
+                             const StringGraph* pGraph, 
+                             ConnectStats* pStats) : m_pBamReader(pBamReader),
+                                                     m_pGraph(pGraph),
+                                                     m_pStats(pStats),
+                                                     m_numConsumed(0) {}
+
+        bool generate(ConnectPairItem& out);
+        inline size_t getNumConsumed() const { return m_numConsumed; }
+
+    private:
+        BamTools::BamReader* m_pBamReader;
+        const StringGraph* m_pGraph;
+        ConnectStats* m_pStats;
+        size_t m_numConsumed;
+};
+
+// Search the graph for the walks connecting a pair. The graph
+// is not modified so one instance can be given to each thread.
+class ConnectPairProcess
+{
+    public:
+        ConnectPairProcess(size_t maxPaths) : m_maxPaths(maxPaths) {}
+        ConnectPairResult process(const ConnectPairItem& item);
+
+    private:
+        size_t m_maxPaths;
+};
+
+// Mark the vertices used by the walks and write the 
+// connected fragments in the order the pairs were read
+class ConnectPairPostProcess
+{
+    public:
+        ConnectPairPostProcess(std::ostream* pWriter, 
+                               size_t maxPaths,
+                               ConnectStats* pStats) : m_pWriter(pWriter), 
+                                                       m_maxPaths(maxPaths), 
+                                                       m_pStats(pStats) {}
+
+        void process(const ConnectPairItem& item, ConnectPairResult& result);
+
+    private:
+        std::ostream* m_pWriter;
+        size_t m_maxPaths;
+        ConnectStats* m_pStats;
+};
+
 // Functions
 void markWalkVertices(SGWalk& walk, GraphColor color);
 void writeWalk(const std::string& name, int walkIdx, const std::string& fragment, std::ostream* pWriter);
@@ -55,12 +151,15 @@ static const char *CONNECT_USAGE_MESSAGE =
 "\n"
 "      --help                           display this help and exit\n"
 "      -v, --verbose                    display verbose output\n"
-//"      -t, --threads=NUM                use NUM threads to compute the overlaps (default: 1)\n"
+"      -t, --threads=NUM                use NUM threads to search for the walks between the pairs (default: 1)\n"
 "      -l, --min-distance=LEN           minimum expected distance between the PE reads (start to end). Default: 150.\n"
 "      -m, --max-distance=LEN           maximum expected distance between the PE reads (start to end). This option specifies\n"
 "                                       how long the search should proceed for. Default: 250\n"
 "      -o, --outfile=FILE               write the connected reads to FILE\n"
 "          --connected-only             only write the connected read pairs, not the unresolved vertices in the graph\n"
+"          --max-nodes=N                abort the search for a pair after exploring N nodes of the graph (default: 10000)\n"
+"          --bidirectional              search from both reads of the pair towards each other. The same walks are found\n"
+"                                       but fewer nodes are explored, so fewer searches hit the --max-nodes limit\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 static const char* PROGRAM_IDENT =
@@ -80,6 +179,9 @@ namespace opt
     // In hetSVMode, we will output up to two paths between the pairs
     static bool hetSVMode = false;
 
+    static size_t maxNodes = 10000;
+    static bool bBidirectional = false;
+
     static std::string outFile;
     static std::string unconnectedFile = "unconnected.fa";
     static std::string asqgFile;
@@ -88,7 +190,7 @@ namespace opt
 
 static const char* shortopts = "p:m:e:t:l:s:o:d:v";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_METRICS, OPT_HETSV, OPT_CONNECTED_ONLY, };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_METRICS, OPT_HETSV, OPT_CONNECTED_ONLY, OPT_MAXNODES, OPT_BIDIRECTIONAL };
 
 static const struct option longopts[] = {
     { "verbose",         no_argument,       NULL, 'v' },
@@ -98,6 +200,8 @@ static const struct option longopts[] = {
     { "min-distance",    required_argument, NULL, 'l' },
     { "connected-only",  no_argument,       NULL, OPT_CONNECTED_ONLY },
     { "het-sv",          no_argument,       NULL, OPT_HETSV },
+    { "max-nodes",       required_argument, NULL, OPT_MAXNODES },
+    { "bidirectional",   no_argument,       NULL, OPT_BIDIRECTIONAL },
     { "help",            no_argument,       NULL, OPT_HELP },
     { "version",         no_argument,       NULL, OPT_VERSION },
     { NULL, 0, NULL, 0 }
@@ -180,246 +284,262 @@ int connectMain(int argc, char** argv)
     std::ostream* pWriter = createWriter(opt::outFile);
     std::cout << "NUM REFS: " << pBamReader->GetReferenceCount() << "\n";
     
-    int numPairsAttempted = 0;
-    int numPairsResolved = 0;
-    int numUnresolvedWrote = 0;
+    ConnectStats stats;
     int numCoveredWrote = 0;
-    int numFailedNoPath = 0;
-    int numFailedMultiPaths = 0;
-    int numFailedUnaligned = 0;
-    int numPathsRejectLow = 0;
-    int numPathsRejectHigh = 0;
-    int numPathsRejectOrientation = 0;    
 
     // In heterozygous SV mode, write up to 2 paths
     size_t maxPaths = (opt::hetSVMode ? 2 : 1);
 
+    // The graph searches are performed in batches by the threads. The vertices
+    // are marked and the fragments are written by the post processor in the
+    // order the pairs were read, so the output does not depend on the number
+    // of threads.
+    ConnectPairGenerator generator(pBamReader, pGraph, &stats);
+    ConnectPairPostProcess postProcessor(pWriter, maxPaths, &stats);
+
+    if(opt::numThreads <= 1)
+    {
+        ConnectPairProcess processor(maxPaths);
+        SequenceProcessFramework::processWorkSerial<ConnectPairItem, 
+                                                    ConnectPairResult, 
+                                                    ConnectPairGenerator, 
+                                                    ConnectPairProcess, 
+                                                    ConnectPairPostProcess>(generator, &processor, &postProcessor);
+    }
+    else
+    {
+        std::vector<ConnectPairProcess*> processorVector;
+        for(int i = 0; i < opt::numThreads; ++i)
+            processorVector.push_back(new ConnectPairProcess(maxPaths));
+
+        SequenceProcessFramework::processWorkParallelPthread<ConnectPairItem, 
+                                                             ConnectPairResult, 
+                                                             ConnectPairGenerator, 
+                                                             ConnectPairProcess, 
+                                                             ConnectPairPostProcess>(generator, processorVector, &postProcessor);
+
+        for(int i = 0; i < opt::numThreads; ++i)
+            delete processorVector[i];
+    }
+
+    //
+    if(opt::bWriteCovered)
+    {
+        CoveredVertexVisitor cvv(pWriter);
+        pGraph->visit(cvv);
+        numCoveredWrote += cvv.getNumWrote();
+    }
+
+    double proc_time_secs = pTimer->getElapsedWallTime();
+    printf("connect: Resolved %d out of %d pairs (%lf) in %lfs (%lf pairs/s)\n",
+            stats.numPairsResolved, stats.numPairsAttempted, 
+            (double)stats.numPairsResolved / stats.numPairsAttempted,
+            proc_time_secs,
+            stats.numPairsAttempted / proc_time_secs);
+
+    printf("Num failed due to no valid path: %d\n", stats.numFailedNoPath);
+    printf("Num failed due to multiple valid paths: %d\n", stats.numFailedMultiPaths);
+    printf("Num searches aborted at the node limit: %zu\n", SGSearch::getNumAbortedSearches());
+    printf("Num failed due to part of the pair not aligning to the graph: %d\n", stats.numFailedUnaligned);
+    printf("Num paths rejected because they are shorter than the minimum distance: %d\n", stats.numPathsRejectLow);
+    printf("Num paths rejected because they are longer than the maximum distance: %d\n", stats.numPathsRejectHigh);
+    printf("Num paths rejected because they are do not have the correct orientation: %d\n", stats.numPathsRejectOrientation);
+
+    printf("Wrote %d unconnected pairs\n", stats.numUnresolvedWrote);
+    printf("Wrote %d vertices that were covered by a path but not full resolved\n", numCoveredWrote);
+
+    delete pTimer;
+    delete pGraph;
+    delete pWriter;
+    delete pBamReader;
+
+    if(opt::numThreads > 1)
+        pthread_exit(NULL);
+
+    return 0;
+}
+
+//
+bool ConnectPairGenerator::generate(ConnectPairItem& out)
+{
     BamTools::BamAlignment record1;
     BamTools::BamAlignment record2;
-    bool done = false;
+    const BamTools::RefVector& referenceVector = m_pBamReader->GetReferenceData();
 
-    const BamTools::RefVector& referenceVector = pBamReader->GetReferenceData();
-    while(!done)
+    while(true)
     {
         // Read a pair from the BAM
         // Read record 1. Skip secondary alignments of the previous pair
         do
         {
-            if(!pBamReader->GetNextAlignment(record1))
-            {
-                done = true;
-                break;
-            }
+            if(!m_pBamReader->GetNextAlignment(record1))
+                return false;
         } while(!record1.IsPrimaryAlignment());
 
-        // Stop if no alignment could be parsed from the stream
-        if(done)
-            break;
-
         // Read record 2. Skip any 
         do
         {
-            if(!pBamReader->GetNextAlignment(record2))
+            if(!m_pBamReader->GetNextAlignment(record2))
             {
-                done = true;
-                break;
+                // If this read failed, there is a mismatch between the pairing
+                std::cout << "Could not read pair for read: " << record1.Name << "\n";
+                return false;
             }
         } while(!record2.IsPrimaryAlignment());
 
-        // If this read failed, there is a mismatch between the pairing
-        if(done)
-        {
-            std::cout << "Could not read pair for read: " << record1.Name << "\n";
-        }
-    
         if(!record1.IsMapped() || !record2.IsMapped())
         {
-            numFailedUnaligned += 1;
+            m_pStats->numFailedUnaligned += 1;
             continue;
         }
+        break;
+    }
 
-        // Ensure the pairing is correct
-        assert(record1.Name == record2.Name);
-        
-        std::string vertexID1 = referenceVector[record1.RefID].RefName;
-        std::string vertexID2 = referenceVector[record2.RefID].RefName;
-
-        // Get the vertices for this pair using the mapped IDs
-        Vertex* pX = pGraph->getVertex(vertexID1);
-        Vertex* pY = pGraph->getVertex(vertexID2);
+    // Ensure the pairing is correct
+    assert(record1.Name == record2.Name);
+    
+    std::string vertexID1 = referenceVector[record1.RefID].RefName;
+    std::string vertexID2 = referenceVector[record2.RefID].RefName;
 
+    // Get the vertices for this pair using the mapped IDs
+    Vertex* pX = m_pGraph->getVertex(vertexID1);
+    Vertex* pY = m_pGraph->getVertex(vertexID2);
 
-        // Ensure that the vertices are found
-        assert(pX != NULL && pY != NULL);
+    // Ensure that the vertices are found
+    assert(pX != NULL && pY != NULL);
 
 #ifdef DEBUG_CONNECT
-        std::cout << "Finding path from " << vertexID1 << " to " << vertexID2 << "\n";
+    std::cout << "Finding path from " << vertexID1 << " to " << vertexID2 << "\n";
 #endif
 
-        EdgeDir walkDirectionXOut = ED_SENSE;
-        EdgeDir walkDirectionYIn = ED_SENSE;
+    EdgeDir walkDirectionXOut = ED_SENSE;
+    EdgeDir walkDirectionYIn = ED_SENSE;
 
-        // Flip walk directions if the alignment is to the reverse strand
-        if(record1.IsReverseStrand())
-            walkDirectionXOut = !walkDirectionXOut;
-        
-        if(record2.IsReverseStrand())
-            walkDirectionYIn = !walkDirectionYIn;
-
-        int fromX = walkDirectionXOut == ED_SENSE ? record1.Position : record1.GetEndPosition();
-        int toY = walkDirectionYIn == ED_SENSE ? record2.Position : record2.GetEndPosition();
+    // Flip walk directions if the alignment is to the reverse strand
+    if(record1.IsReverseStrand())
+        walkDirectionXOut = !walkDirectionXOut;
+    
+    if(record2.IsReverseStrand())
+        walkDirectionYIn = !walkDirectionYIn;
+
+    int fromX = walkDirectionXOut == ED_SENSE ? record1.Position : record1.GetEndPosition();
+    int toY = walkDirectionYIn == ED_SENSE ? record2.Position : record2.GetEndPosition();
+
+    // Calculate the amount of contig X that already covers the fragment
+    // Using this number, we calculate how far we should search
+    int coveredX = walkDirectionXOut == ED_SENSE ? pX->getSeqLen() - fromX : fromX;
+
+    out.read1.id = record1.Name;
+    out.read1.seq = record1.QueryBases;
+    out.read2.id = record2.Name;
+    out.read2.seq = record2.QueryBases;
+    out.pX = pX;
+    out.pY = pY;
+    out.walkDirectionXOut = walkDirectionXOut;
+    out.walkDirectionYIn = walkDirectionYIn;
+    out.fromX = fromX;
+    out.toY = toY;
+    out.maxWalkDistance = opt::maxDistance - coveredX;
+    m_numConsumed += 1;
+    return true;
+}
 
-        // Calculate the amount of contig X that already covers the fragment
-        // Using this number, we calculate how far we should search
-        int coveredX = walkDirectionXOut == ED_SENSE ? pX->getSeqLen() - fromX : fromX;
-        int maxWalkDistance = opt::maxDistance - coveredX;
+//
+ConnectPairResult ConnectPairProcess::process(const ConnectPairItem& item)
+{
+    ConnectPairResult result;
+    if(opt::bBidirectional)
+        SGSearch::findWalksBidirectional(item.pX, item.pY, item.walkDirectionXOut, item.maxWalkDistance, opt::maxNodes, true, result.walks);
+    else
+        SGSearch::findWalks(item.pX, item.pY, item.walkDirectionXOut, item.maxWalkDistance, opt::maxNodes, true, result.walks);
+
+    // Build the fragment strings for the walks that could be written out
+    if(!result.walks.empty() && result.walks.size() <= m_maxPaths)
+    {
+        for(size_t i = 0; i < result.walks.size(); ++i)
+        {
+            result.fragments.push_back(result.walks[i].getFragmentString(item.pX, 
+                                                                         item.pY, 
+                                                                         item.fromX,
+                                                                         item.toY,
+                                                                         item.walkDirectionXOut,
+                                                                         item.walkDirectionYIn));
+        }
+    }
+    return result;
+}
 
-        SGWalkVector walks;
-        SGSearch::findWalks(pX, pY, walkDirectionXOut, maxWalkDistance, 10000, true, walks);
+//
+void ConnectPairPostProcess::process(const ConnectPairItem& item, ConnectPairResult& result)
+{
+    SGWalkVector& walks = result.walks;
 
-        // Mark used vertices in the graph
-        // If the entire path was resolved, mark black
-        // otherwise mark as red
-        GraphColor used_color = (walks.size() <= maxPaths) ? GC_BLACK : GC_RED;
+    // Mark used vertices in the graph
+    // If the entire path was resolved, mark black
+    // otherwise mark as red
+    GraphColor used_color = (walks.size() <= m_maxPaths) ? GC_BLACK : GC_RED;
 
-        for(size_t i = 0; i < walks.size(); i +=1 )
-            markWalkVertices(walks[i], used_color);
+    for(size_t i = 0; i < walks.size(); i +=1 )
+        markWalkVertices(walks[i], used_color);
 
-        if(!walks.empty() && walks.size() <= maxPaths)
-        {
-            for(size_t i = 0; i < walks.size(); ++i)
-            {
-                // Validate that the path is as expected
-                // This has 2 conditions:
-                // 1) The inferred fragment is orientated correctly
-                // 2) The fragment size is within the expected range
-                bool correctOrientation = true;
-                WARN_ONCE("check orientation of result");
-
-                std::string fragment = walks[i].getFragmentString(pX, 
-                                                                  pY, 
-                                                                  fromX,
-                                                                  toY,
-                                                                  walkDirectionXOut,
-                                                                  walkDirectionYIn);
-
-                // Calculate the seqcoord on the path string representing the paired end fragment
-                int fragSize = fragment.length();
-                bool correctSize = !fragment.empty();
-
-                if(fragSize < opt::minDistance)
-                {
-                    correctSize = false;
-                    numPathsRejectLow += 1;
-                }
-
-                if(fragSize > opt::maxDistance)
-                {
-                    correctSize = false;
-                    numPathsRejectHigh += 1;
-                }
-
-
-                if(correctOrientation && correctSize)
-                {                    
-                    writeWalk(getPairBasename(record1.Name), i, fragment, pWriter);
-                    
-                    // Mark all the vertices in this walk as resolved
-                    markWalkVertices(walks[i], GC_BLACK);
-                    numPairsResolved += 1;
-                }
-            }
-        }
-        else
+    if(!walks.empty() && walks.size() <= m_maxPaths)
+    {
+        for(size_t i = 0; i < walks.size(); ++i)
         {
-            if(walks.empty())
+            // Validate that the path is as expected
+            // This has 2 conditions:
+            // 1) The inferred fragment is orientated correctly
+            // 2) The fragment size is within the expected range
+            bool correctOrientation = true;
+            WARN_ONCE("check orientation of result");
+
+            const std::string& fragment = result.fragments[i];
+
+            // Calculate the seqcoord on the path string representing the paired end fragment
+            int fragSize = fragment.length();
+            bool correctSize = !fragment.empty();
+
+            if(fragSize < opt::minDistance)
             {
-                /*
-                std::cout << "No walk found for pair: \n";
-                std::cout << record1.Name << " " << vertexID1 << " -> " << vertexID2 << "\n";
-                std::cout << "Map qual: " << record1.MapQuality << " " << record2.MapQuality << "\n";
-                int xa1 = 0;
-                int xa2 = 0;
-                record1.GetTag("X1", xa1);
-                record2.GetTag("X1", xa2);
-                std::cout << "Num sub1: " << xa1 << "\n";
-                std::cout << "Num sub2: " << xa2 << "\n";
-                std::cout << "Total alts: " << (xa1 + xa2) << "\n";
-                */
-                numFailedNoPath += 1;
+                correctSize = false;
+                m_pStats->numPathsRejectLow += 1;
             }
-            else if(walks.size() > maxPaths)
+
+            if(fragSize > opt::maxDistance)
             {
-                /*
-                for(size_t i = 0; i < walks.size(); ++i)
-                {
-                    std::string fragment = walks[i].getFragmentString(pX, 
-                                                                      pY, 
-                                                                      fromX,
-                                                                      toY,
-                                                                      walkDirectionXOut,
-                                                                      walkDirectionYIn);
-
-                    //std::cout << i << " " << walks[i].pathSignature() << " size: " << fragment.size() << "\n";
-                    //std::cout << ">" << i << "\n" << fragment << "\n";
-                }
-                */
-
-                numFailedMultiPaths += 1;
+                correctSize = false;
+                m_pStats->numPathsRejectHigh += 1;
             }
-            if(opt::bWriteUnresolved)
-            {
-                // Write the unconnected reads
-                SeqRecord unresolved1;
-                unresolved1.id = record1.Name;
-                unresolved1.seq = record1.QueryBases;
-                
-                SeqRecord unresolved2;
-                unresolved2.id = record2.Name;
-                unresolved2.seq = record2.QueryBases;
 
-                unresolved1.write(*pWriter);
-                unresolved2.write(*pWriter);
-
-                numUnresolvedWrote += 2;
+            if(correctOrientation && correctSize)
+            {                    
+                writeWalk(getPairBasename(item.read1.id), i, fragment, m_pWriter);
+                
+                // Mark all the vertices in this walk as resolved
+                markWalkVertices(walks[i], GC_BLACK);
+                m_pStats->numPairsResolved += 1;
             }
         }
-        numPairsAttempted += 1;
-        
-        if(numPairsAttempted % 50000 == 0)
-            printf("[sga connect] Processed %d pairs\n", numPairsAttempted);
     }
-
-    //
-    if(opt::bWriteCovered)
+    else
     {
-        CoveredVertexVisitor cvv(pWriter);
-        pGraph->visit(cvv);
-        numCoveredWrote += cvv.getNumWrote();
-    }
+        if(walks.empty())
+            m_pStats->numFailedNoPath += 1;
+        else if(walks.size() > m_maxPaths)
+            m_pStats->numFailedMultiPaths += 1;
 
-    double proc_time_secs = pTimer->getElapsedWallTime();
-    printf("connect: Resolved %d out of %d pairs (%lf) in %lfs (%lf pairs/s)\n",
-            numPairsResolved, numPairsAttempted, 
-            (double)numPairsResolved / numPairsAttempted,
-            proc_time_secs,
-            numPairsAttempted / proc_time_secs);
-
-    printf("Num failed due to no valid path: %d\n", numFailedNoPath);
-    printf("Num failed due to multiple valid paths: %d\n", numFailedMultiPaths);
-    printf("Num failed due to part of the pair not aligning to the graph: %d\n", numFailedUnaligned);
-    printf("Num paths rejected because they are shorter than the minimum distance: %d\n", numPathsRejectLow);
-    printf("Num paths rejected because they are longer than the maximum distance: %d\n", numPathsRejectHigh);
-    printf("Num paths rejected because they are do not have the correct orientation: %d\n", numPathsRejectOrientation);
-
-    printf("Wrote %d unconnected pairs\n", numUnresolvedWrote);
-    printf("Wrote %d vertices that were covered by a path but not full resolved\n", numCoveredWrote);
-
-    delete pTimer;
-    delete pGraph;
-    delete pWriter;
-    delete pBamReader;
-    return 0;
+        if(opt::bWriteUnresolved)
+        {
+            // Write the unconnected reads
+            item.read1.write(*m_pWriter);
+            item.read2.write(*m_pWriter);
+            m_pStats->numUnresolvedWrote += 2;
+        }
+    }
+    m_pStats->numPairsAttempted += 1;
+    
+    if(m_pStats->numPairsAttempted % 50000 == 0)
+        printf("[sga connect] Processed %d pairs\n", m_pStats->numPairsAttempted);
 }
 
 // Write the given walk out to the file
@@ -478,6 +598,8 @@ void parseConnectOptions(int argc, char** argv)
                 opt::bWriteUnresolved = false; 
                 break;
             case OPT_HETSV: opt::hetSVMode = true; break;
+            case OPT_MAXNODES: arg >> opt::maxNodes; break;
+            case OPT_BIDIRECTIONAL: opt::bBidirectional = true; break;
             case OPT_HELP:
                 std::cout << CONNECT_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
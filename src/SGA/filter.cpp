@@ -50,6 +50,8 @@ static const char *FILTER_USAGE_MESSAGE =
 "The currently available filters are removing exact-match duplicates\n"
 "and removing reads with low-frequency k-mers.\n"
 "Automatically rebuilds the FM-index without the discarded reads.\n"
+"The IDs of the kept reads are written to a bit vector in OUTPREFIX.kept, which\n"
+"maps read IDs in the original index to read IDs in the rebuilt index.\n"
 "\n"
 "      --help                           display this help and exit\n"
 "      -v, --verbose                    display verbose output\n"
@@ -192,7 +194,7 @@ int filterMain(int argc, char** argv)
 
     // Rebuild the FM-index without the discarded reads
     std::string out_prefix = stripFilename(opt::outFile);
-    removeReadsFromIndices(opt::prefix, opt::discardFile, out_prefix, BWT_EXT, SAI_EXT, false, opt::numThreads);
+    removeReadsFromIndices(opt::prefix, opt::discardFile, out_prefix, BWT_EXT, SAI_EXT, false, opt::numThreads, out_prefix + KEPT_EXT);
     removeReadsFromIndices(opt::prefix, opt::discardFile, out_prefix, RBWT_EXT, RSAI_EXT, true, opt::numThreads);
 
     // Cleanup
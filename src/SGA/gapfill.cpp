@@ -22,11 +22,11 @@
 #include "gapfill.h"
 
 // Defines to clarify awful template function calls
-#define PROCESS_GAPFILL_SERIAL SequenceProcessFramework::processSequencesSerial<SequenceWorkItem, GraphCompareResult, \
-                                                                                GraphCompare, GraphCompareAggregateResults>
+#define PROCESS_GAPFILL_SERIAL SequenceProcessFramework::processWorkSerial<GapFillWorkItem, GapFillResult, \
+                                                                           GapFillWorkItemGenerator, GapFillProcess, GapFillPostProcess>
 
-#define PROCESS_GAPFILL_PARALLEL SequenceProcessFramework::processSequencesParallel<SequenceWorkItem, GraphCompareResult, \
-                                                                                    GraphCompare, GraphCompareAggregateResults>
+#define PROCESS_GAPFILL_PARALLEL SequenceProcessFramework::processWorkParallelPthread<GapFillWorkItem, GapFillResult, \
+                                                                                     GapFillWorkItemGenerator, GapFillProcess, GapFillPostProcess>
 
    
 //
@@ -115,18 +115,33 @@ int gapfillMain(int argc, char** argv)
     parameters.kmerThreshold = opt::kmerThreshold;
     parameters.verbose = opt::verbose;
 
-    GapFillProcess processor(parameters);
-
     std::ostream* pWriter = createWriter(opt::outFile);
+    GapFillPostProcess* pPostProcessor = new GapFillPostProcess(pWriter, opt::verbose);
 
+    // Scaffolds are split into segments that can be filled independently
+    // so that the gaps of a single large scaffold can be spread over the threads
     SeqReader reader(opt::scaffoldFile, SRF_NO_VALIDATION | SRF_KEEP_CASE);
-    SeqRecord record;
-    while(reader.get(record))
+    GapFillWorkItemGenerator generator(&reader, opt::startKmer, opt::verbose);
+
+    if(opt::numThreads <= 1)
     {
-        GapFillResult result = processor.processScaffold(record.seq.toString());
-        record.seq = result.scaffold;
-        record.write(*pWriter);
+        GapFillProcess processor(parameters);
+        PROCESS_GAPFILL_SERIAL(generator, &processor, pPostProcessor);
     }
+    else
+    {
+        std::vector<GapFillProcess*> processorVector;
+        for(int i = 0; i < opt::numThreads; ++i)
+            processorVector.push_back(new GapFillProcess(parameters));
+
+        PROCESS_GAPFILL_PARALLEL(generator, processorVector, pPostProcessor);
+
+        for(int i = 0; i < opt::numThreads; ++i)
+            delete processorVector[i];
+    }
+
+    // Print the statistics and flush the writer
+    delete pPostProcessor;
 
     // Cleanup
     delete pWriter;
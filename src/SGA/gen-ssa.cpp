@@ -16,6 +16,7 @@
 #include "SeqReader.h"
 #include "SACAInducedCopying.h"
 #include "SampledSuffixArray.h"
+#include "PopulationColorIndex.h"
 #include "BWTDiskConstruction.h"
 #include "BWT.h"
 #include "Timer.h"
@@ -39,6 +40,8 @@ static const char *GENSSA_USAGE_MESSAGE =
 "      --help                           display this help and exit\n"
 "  -t, --threads=NUM                    use NUM threads to construct the index (default: 1)\n"
 "  -c, --check                          validate that the suffix array/bwt is correct\n"
+"      --population-colors              instead of the sampled suffix array, build the index of the sample\n"
+"                                       each suffix belongs to (PREFIX.popcolor) using PREFIX.popidx\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 namespace opt
@@ -49,16 +52,18 @@ namespace opt
     static int numThreads = 1;
     static int sampleRate = 32;
     static bool validate = false;
+    static bool bPopulationColors = false;
 }
 
 static const char* shortopts = "t:cv";
 
-enum { OPT_HELP = 1, OPT_VERSION };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_POPCOLORS };
 
 static const struct option longopts[] = {
     { "verbose",     no_argument,       NULL, 'v' },
     { "check",       no_argument,       NULL, 'c' },
     { "threads",     required_argument, NULL, 't' },
+    { "population-colors", no_argument,   NULL, OPT_POPCOLORS },
     { "help",        no_argument,       NULL, OPT_HELP },
     { "version",     no_argument,       NULL, OPT_VERSION },
     { NULL, 0, NULL, 0 }
@@ -70,6 +75,19 @@ int genSSAMain(int argc, char** argv)
     parseGenSSAOptions(argc, argv);
     
     BWT* pBWT = new BWT(opt::prefix + BWT_EXT);
+    if(opt::bPopulationColors)
+    {
+        PopulationIndex* pPopIdx = new PopulationIndex(opt::prefix + POPIDX_EXT);
+        PopulationColorIndex* pColors = new PopulationColorIndex();
+        pColors->build(pBWT, pPopIdx);
+        pColors->printInfo();
+        pColors->write(opt::prefix + POPCOLOR_EXT);
+        delete pColors;
+        delete pPopIdx;
+        delete pBWT;
+        return 0;
+    }
+
     ReadInfoTable* pRIT = new ReadInfoTable(opt::readsFile, pBWT->getNumStrings(), RIO_NUMERICID);
     pBWT->printInfo();
 
@@ -101,6 +119,7 @@ void parseGenSSAOptions(int argc, char** argv)
         {
             case '?': die = true; break;
             case 'c': opt::validate = true; break;
+            case OPT_POPCOLORS: opt::bPopulationColors = true; break;
             case 't': arg >> opt::numThreads; break;
             case 'v': opt::verbose++; break;
             case OPT_HELP:
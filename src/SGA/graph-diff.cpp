@@ -80,6 +80,9 @@ static const char *GRAPH_DIFF_USAGE_MESSAGE =
 "          --paired-debruijn            use the de Bruijn graph assembly algorithm with paired-end constraints(default: string graph)\n"
 "      -m, --min-overlap=N              require at least N bp overlap when assembling using a string graph\n" 
 "          --min-dbg-count=T            only use k-mers seen T times when assembling using a de Bruijn graph\n"
+"          --hmm-single-precision       realign reads to haplotypes using the faster single precision HMM\n"
+"          --hmm-threads=NUM            use NUM threads to realign the reads of large variant windows (default: 1)\n"
+"                                       this is in addition to the --threads workers, which process windows in parallel\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 namespace opt
@@ -104,6 +107,8 @@ namespace opt
     static bool lowCoverage = false;
     static bool referenceMode = false;
     static bool useQualityScores = false;
+    static bool hmmSinglePrecision = false;
+    static int hmmThreads = 1;
 
     // I/O
     static std::string outPrefix = "sgavariants";
@@ -129,7 +134,9 @@ enum { OPT_HELP = 1,
        OPT_LOWCOVERAGE, 
        OPT_QUALSCORES,
        OPT_BLOOM_GENOME,
-       OPT_PRECACHE_REFERENCE };
+       OPT_PRECACHE_REFERENCE,
+       OPT_HMM_SINGLE_PRECISION,
+       OPT_HMM_THREADS };
 
 static const struct option longopts[] = {
     { "verbose",              no_argument,       NULL, 'v' },
@@ -145,6 +152,8 @@ static const struct option longopts[] = {
     { "paired-debruijn",      no_argument,       NULL, OPT_PAIRED_DEBRUIJN },
     { "low-coverage",         no_argument,       NULL, OPT_LOWCOVERAGE },
     { "use-quality-scores",   no_argument,       NULL, OPT_QUALSCORES},
+    { "hmm-single-precision", no_argument,       NULL, OPT_HMM_SINGLE_PRECISION },
+    { "hmm-threads",          required_argument, NULL, OPT_HMM_THREADS },
     { "index",                required_argument, NULL, OPT_INDEX },
     { "min-dbg-count",        required_argument, NULL, OPT_MIN_DBG_COUNT },
     { "debug",                required_argument, NULL, OPT_DEBUG },
@@ -268,6 +277,10 @@ int graphDiffMain(int argc, char** argv)
         sharedParameters.dindelRealignParameters.multiSample = 1;
     }
 
+    if(opt::hmmSinglePrecision)
+        sharedParameters.dindelRealignParameters.hmmSinglePrecision = 1;
+    sharedParameters.dindelRealignParameters.hmmThreads = opt::hmmThreads;
+
     if(!opt::debugFile.empty())
     {
         runDebug(sharedParameters);
@@ -471,6 +484,8 @@ void parseGraphDiffOptions(int argc, char** argv)
             case OPT_TESTVCF: arg >> opt::inputVCFFile; break;
             case OPT_INDEX: arg >> opt::indexPrefix; break;
             case OPT_QUALSCORES:  opt::useQualityScores = true; break;
+            case OPT_HMM_SINGLE_PRECISION: opt::hmmSinglePrecision = true; break;
+            case OPT_HMM_THREADS: arg >> opt::hmmThreads; break;
             case OPT_HELP:
                 std::cout << GRAPH_DIFF_USAGE_MESSAGE;
                 exit(EXIT_SUCCESS);
@@ -493,6 +508,12 @@ void parseGraphDiffOptions(int argc, char** argv)
         die = true;
     }
 
+    if(opt::hmmThreads <= 0 || opt::hmmThreads > 256)
+    {
+        std::cerr << SUBPROGRAM ": invalid number of HMM threads: " << opt::hmmThreads << "\n";
+        die = true;
+    }
+
     if(opt::variantFile.empty())
     {
         std::cerr << SUBPROGRAM ": error a --base and --variant file must be provided\n";
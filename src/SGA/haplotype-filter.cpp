@@ -11,6 +11,8 @@
 #include <fstream>
 #include <sstream>
 #include <iterator>
+#include <iomanip>
+#include <sys/stat.h>
 #include "Util.h"
 #include "haplotype-filter.h"
 #include "BWTAlgorithms.h"
@@ -22,6 +24,10 @@
 #include "SGAStats.h"
 #include "HashMap.h"
 
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
+
 // Functions
 // Add the log-scaled values l1 and l2 using a transform to avoid
 // precision errors
@@ -45,6 +51,12 @@ std::vector<size_t> getPopulationCoverageCount(const std::string& kmer, const BW
 // Get the mean depth of a random k-mer in each sample
 std::vector<double> getSampleMeanKmerDepth(size_t k, const BWTIndexSet& indices);
 
+// Get the mean depth of each sample from the depth file next to the population index.
+// The depths are computed and the file is written if it is missing or stale.
+std::vector<double> getCachedSampleMeanKmerDepth(const std::string& prefix, size_t k, const BWTIndexSet& indices);
+bool readSampleDepthsCache(const std::string& prefix, size_t k, const BWTIndexSet& indices, std::vector<double>& depths);
+void writeSampleDepthsCache(const std::string& prefix, size_t k, const BWTIndexSet& indices, const std::vector<double>& depths);
+
 //
 double LMHaploid(double d, const std::vector<size_t>& sample_count);
 double LMHaploidNonUniform(const std::vector<double>& depths, const std::vector<size_t>& sample_count);
@@ -69,6 +81,74 @@ std::vector<double> simulateSampleKmerDepths(size_t mean_depth, size_t N);
 //
 void runSimulation();
 
+typedef HashMap<std::string, size_t> KmerHaplotypeMap;
+
+// A line of the input VCF
+struct HaplotypeFilterItem
+{
+    std::string line;
+};
+
+// The annotated VCF line and the diagnostic
+// output for the record
+struct HaplotypeFilterResult
+{
+    std::string line;
+    std::string log;
+};
+
+// Read the lines of the VCF file
+class HaplotypeFilterGenerator
+{
+    public:
+        HaplotypeFilterGenerator(std::istream* pReader) : m_pReader(pReader), m_numConsumed(0) {}
+
+        bool generate(HaplotypeFilterItem& out);
+        inline size_t getNumConsumed() const { return m_numConsumed; }
+
+    private:
+        std::istream* m_pReader;
+        size_t m_numConsumed;
+};
+
+// Compute the segregation statistics for the haplotype of a VCF record.
+// The indices and the haplotypes are only read so one instance can be
+// given to each thread.
+class HaplotypeFilterProcess
+{
+    public:
+        HaplotypeFilterProcess(const BWTIndexSet& indices,
+                               const BWTIndexSet& referenceIndex,
+                               const KmerHaplotypeMap& kmerToHaplotype,
+                               const StringVector& haplotypes,
+                               const std::vector<double>& depths) : m_indices(indices),
+                                                                    m_referenceIndex(referenceIndex),
+                                                                    m_kmerToHaplotype(kmerToHaplotype),
+                                                                    m_haplotypes(haplotypes),
+                                                                    m_depths(depths) {}
+
+        HaplotypeFilterResult process(const HaplotypeFilterItem& item);
+
+    private:
+        const BWTIndexSet& m_indices;
+        const BWTIndexSet& m_referenceIndex;
+        const KmerHaplotypeMap& m_kmerToHaplotype;
+        const StringVector& m_haplotypes;
+        const std::vector<double>& m_depths;
+};
+
+// Write the annotated records in the order they were read
+class HaplotypeFilterPostProcess
+{
+    public:
+        HaplotypeFilterPostProcess(std::ostream* pWriter) : m_pWriter(pWriter) {}
+
+        void process(const HaplotypeFilterItem& item, const HaplotypeFilterResult& result);
+
+    private:
+        std::ostream* m_pWriter;
+};
+
 //
 // Getopt
 //
@@ -82,6 +162,8 @@ SUBPROGRAM " Version " PACKAGE_VERSION "\n"
 static const char *HAPLOTYPE_FILTER_USAGE_MESSAGE =
 "Usage: " PACKAGE_NAME " " SUBPROGRAM " [OPTION] ... HAPLOTYPE_FILE VCF_FILE\n"
 "Remove haplotypes and their associated variants from a data set.\n"
+"The mean k-mer depth of each sample is cached in the file READS.popdepth next to the\n"
+"population index and is recomputed when the index or the --population-colors setting changes.\n"
 "\n"
 "      --help                           display this help and exit\n"
 "      -v, --verbose                    display verbose output\n"
@@ -89,7 +171,12 @@ static const char *HAPLOTYPE_FILTER_USAGE_MESSAGE =
 "          --reference=STR              load the reference genome from FILE\n"
 "          --haploid                    force use of the haploid model\n"
 "      -o, --out-prefix=STR             write the passed haplotypes and variants to STR.vcf and STR.fa\n" 
-"      -t, --threads=NUM                use NUM threads to compute the overlaps (default: 1)\n"
+"      -t, --threads=NUM                use NUM threads to compute the sample depths and annotate\n"
+"                                       the VCF records (default: 1)\n"
+"          --population-colors          count the k-mer coverage of each sample using READS.popcolor (built by\n"
+"                                       sga gen-ssa --population-colors) instead of the sampled suffix array.\n"
+"                                       This is faster but counts occurrences of a k-mer rather than reads, so a\n"
+"                                       read containing the k-mer (or its reverse complement) twice is counted twice\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 static const char* PROGRAM_IDENT =
@@ -106,11 +193,12 @@ namespace opt
     static std::string haplotypeFile;
     static std::string vcfFile;
     static std::string referenceFile;
+    static bool bUsePopColors = false;
 }
 
 static const char* shortopts = "o:r:k:t:v";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_REFERENCE, OPT_HAPLOID };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_REFERENCE, OPT_HAPLOID, OPT_POPCOLORS };
 
 static const struct option longopts[] = {
     { "verbose",               no_argument,       NULL, 'v' },
@@ -119,6 +207,7 @@ static const struct option longopts[] = {
     { "reads",                 required_argument, NULL, 'r' },
     { "reference",             required_argument, NULL, OPT_REFERENCE },
     { "haploid",               no_argument,       NULL, OPT_HAPLOID },
+    { "population-colors",     no_argument,       NULL, OPT_POPCOLORS },
     { "help",                  no_argument,       NULL, OPT_HELP },
     { "version",               no_argument,       NULL, OPT_VERSION },
     { NULL, 0, NULL, 0 }
@@ -143,6 +232,23 @@ int haplotypeFilterMain(int argc, char** argv)
     indices.pBWT = new BWT(prefix + BWT_EXT);
     indices.pPopIdx = new PopulationIndex(prefix + POPIDX_EXT);
     indices.pSSA = new SampledSuffixArray(prefix + SAI_EXT, SSA_FT_SAI);
+
+    // Count the occurrences in each sample using the color index, if requested
+    if(opt::bUsePopColors)
+    {
+        std::string colorsFile = prefix + POPCOLOR_EXT;
+        PopulationColorIndex* pPopColors = new PopulationColorIndex(colorsFile);
+
+        // The color index must have been built from the loaded BWT and population index
+        if(pPopColors->getLength() != indices.pBWT->getBWLen() ||
+           pPopColors->getNumSamples() != indices.pPopIdx->getNumSamples())
+        {
+            std::cerr << "\nError: " << colorsFile << " does not match the index of " << opt::readsFile 
+                      << ", rebuild it with sga gen-ssa --population-colors\n";
+            exit(EXIT_FAILURE);
+        }
+        indices.pPopColors = pPopColors;
+    }
     indices.pQualityTable = new QualityTable();
     std::cout << "done\n";
 
@@ -154,11 +260,11 @@ int haplotypeFilterMain(int argc, char** argv)
     std::cout << "done" << std::endl;
 
     //std::vector<double> depths = loadSampleDepthsFromFile("depths.k31.txt");
-    std::vector<double> depths = getSampleMeanKmerDepth(opt::k, indices);
+    std::vector<double> depths = getCachedSampleMeanKmerDepth(prefix, opt::k, indices);
 
     // Read haplotypes into a kmer hash
     size_t assembly_k = 61; // hack hack
-    HashMap<std::string, size_t> kmer_to_haplotype;
+    KmerHaplotypeMap kmer_to_haplotype;
     StringVector haplotypes;
 
     std::cout << "Loading haplotypes\n";
@@ -180,81 +286,40 @@ int haplotypeFilterMain(int argc, char** argv)
     std::ofstream outFile(opt::outFile.c_str());
     std::ifstream inFile(opt::vcfFile.c_str());
 
-    std::string line;
-    while(getline(inFile, line))
-    {
-        assert(line.size() > 0);
-        if(line[0] == '#')
-        {
-            outFile << line << "\n";
-            continue;
-        }
-
-        StringVector fields = split(line, '\t');
-        std::string vcf_kmer = fields[2];
-        
-        // Load the haplotype with this kmer
-        HashMap<std::string, size_t>::iterator iter = kmer_to_haplotype.find(vcf_kmer);
-        if(iter == kmer_to_haplotype.end())
-            iter = kmer_to_haplotype.find(reverseComplement(vcf_kmer));
-
-        assert(iter != kmer_to_haplotype.end());
-        std::string& haplotype = haplotypes[iter->second];
-        
-        printf("Kmer --- %s\n", vcf_kmer.c_str());
-        printf("Haplotype --- %s\n", haplotype.c_str());
-
-        // Find the highest-depth non-reference kmer to use to calculate the segregation stats
-        size_t best_index = 0;
-        size_t best_count = 0;
-        size_t nk = haplotype.size() - opt::k + 1;
-        for(size_t i = 0; i < nk; ++i)
-        {
-            std::string seg_kmer = haplotype.substr(i, opt::k);
-            size_t ref_c = BWTAlgorithms::countSequenceOccurrences(seg_kmer, referenceIndex);
-            printf("seg_kmer --- %s ref_c? %zu\n", seg_kmer.c_str(), ref_c);
-            if(ref_c == 0)
-            {
-                size_t read_c = BWTAlgorithms::countSequenceOccurrences(seg_kmer, indices);
-                if(read_c > best_count)
-                {
-                    best_count = read_c;
-                    best_index = i;
-                }
-                printf("read_c: %zu\n", read_c);
-            }
-        }
-        
-        double LM = 0.f;
-        size_t total_coverage = 0;
-        if(best_count > 0)
-        {
-            std::string kmer = haplotype.substr(best_index, opt::k);
-            std::vector<size_t> sample_coverage = getPopulationCoverageCount(kmer, indices);
-            std::copy(sample_coverage.begin(), sample_coverage.end(), std::ostream_iterator<size_t>(std::cout, " "));
-            std::cout << "\n";
-          
-            for(size_t i = 0; i < sample_coverage.size(); ++i)
-                total_coverage += sample_coverage[i];
-            
-            if(opt::bHaploid)
-                LM = LMHaploidNonUniform(depths, sample_coverage);
-            else
-                LM = LMDiploidNonUniform(depths, sample_coverage);
-        }
+    // The VCF records are annotated by the threads and written
+    // by the post processor in the order they were read
+    HaplotypeFilterGenerator generator(&inFile);
+    HaplotypeFilterPostProcess postProcessor(&outFile);
 
-        std::stringstream lmss;
-        lmss << fields[7];
-        lmss << ";LM=" << LM << ";";
-        lmss << "O=" << total_coverage << ";";
-        fields[7] = lmss.str();
-        std::copy(fields.begin(), fields.end(), std::ostream_iterator<std::string>(outFile, "\t"));
-        outFile << "\n";
+    if(opt::numThreads <= 1)
+    {
+        HaplotypeFilterProcess processor(indices, referenceIndex, kmer_to_haplotype, haplotypes, depths);
+        SequenceProcessFramework::processWorkSerial<HaplotypeFilterItem,
+                                                    HaplotypeFilterResult,
+                                                    HaplotypeFilterGenerator,
+                                                    HaplotypeFilterProcess,
+                                                    HaplotypeFilterPostProcess>(generator, &processor, &postProcessor);
     }
-    
+    else
+    {
+        std::vector<HaplotypeFilterProcess*> processorVector;
+        for(int i = 0; i < opt::numThreads; ++i)
+            processorVector.push_back(new HaplotypeFilterProcess(indices, referenceIndex, kmer_to_haplotype, haplotypes, depths));
+
+        SequenceProcessFramework::processWorkParallelPthread<HaplotypeFilterItem,
+                                                             HaplotypeFilterResult,
+                                                             HaplotypeFilterGenerator,
+                                                             HaplotypeFilterProcess,
+                                                             HaplotypeFilterPostProcess>(generator, processorVector, &postProcessor);
+
+        for(int i = 0; i < opt::numThreads; ++i)
+            delete processorVector[i];
+    }
+
     // Cleanup
     delete indices.pBWT;
     delete indices.pPopIdx;
+    delete indices.pPopColors;
     delete indices.pQualityTable;
     delete referenceIndex.pBWT;
     delete pTimer;
@@ -265,6 +330,104 @@ int haplotypeFilterMain(int argc, char** argv)
     return 0;
 }
 
+//
+bool HaplotypeFilterGenerator::generate(HaplotypeFilterItem& out)
+{
+    if(!getline(*m_pReader, out.line))
+        return false;
+    m_numConsumed += 1;
+    return true;
+}
+
+//
+HaplotypeFilterResult HaplotypeFilterProcess::process(const HaplotypeFilterItem& item)
+{
+    HaplotypeFilterResult result;
+    const std::string& line = item.line;
+
+    assert(line.size() > 0);
+    if(line[0] == '#')
+    {
+        result.line = line + "\n";
+        return result;
+    }
+
+    StringVector fields = split(line, '\t');
+    std::string vcf_kmer = fields[2];
+    
+    // Load the haplotype with this kmer
+    KmerHaplotypeMap::const_iterator iter = m_kmerToHaplotype.find(vcf_kmer);
+    if(iter == m_kmerToHaplotype.end())
+        iter = m_kmerToHaplotype.find(reverseComplement(vcf_kmer));
+
+    assert(iter != m_kmerToHaplotype.end());
+    const std::string& haplotype = m_haplotypes[iter->second];
+    
+    std::stringstream log;
+    log << "Kmer --- " << vcf_kmer << "\n";
+    log << "Haplotype --- " << haplotype << "\n";
+
+    // Find the highest-depth non-reference kmer to use to calculate the segregation stats
+    size_t best_index = 0;
+    size_t best_count = 0;
+    size_t nk = haplotype.size() - opt::k + 1;
+    for(size_t i = 0; i < nk; ++i)
+    {
+        std::string seg_kmer = haplotype.substr(i, opt::k);
+        size_t ref_c = BWTAlgorithms::countSequenceOccurrences(seg_kmer, m_referenceIndex);
+        log << "seg_kmer --- " << seg_kmer << " ref_c? " << ref_c << "\n";
+        if(ref_c == 0)
+        {
+            size_t read_c = BWTAlgorithms::countSequenceOccurrences(seg_kmer, m_indices);
+            if(read_c > best_count)
+            {
+                best_count = read_c;
+                best_index = i;
+            }
+            log << "read_c: " << read_c << "\n";
+        }
+    }
+    
+    double LM = 0.f;
+    size_t total_coverage = 0;
+    if(best_count > 0)
+    {
+        std::string kmer = haplotype.substr(best_index, opt::k);
+        std::vector<size_t> sample_coverage = getPopulationCoverageCount(kmer, m_indices);
+        std::copy(sample_coverage.begin(), sample_coverage.end(), std::ostream_iterator<size_t>(log, " "));
+        log << "\n";
+      
+        for(size_t i = 0; i < sample_coverage.size(); ++i)
+            total_coverage += sample_coverage[i];
+        
+        if(opt::bHaploid)
+            LM = LMHaploidNonUniform(m_depths, sample_coverage);
+        else
+            LM = LMDiploidNonUniform(m_depths, sample_coverage);
+    }
+
+    std::stringstream lmss;
+    lmss << fields[7];
+    lmss << ";LM=" << LM << ";";
+    lmss << "O=" << total_coverage << ";";
+    fields[7] = lmss.str();
+
+    std::stringstream out;
+    std::copy(fields.begin(), fields.end(), std::ostream_iterator<std::string>(out, "\t"));
+    out << "\n";
+
+    result.line = out.str();
+    result.log = log.str();
+    return result;
+}
+
+//
+void HaplotypeFilterPostProcess::process(const HaplotypeFilterItem& /*item*/, const HaplotypeFilterResult& result)
+{
+    std::cout << result.log;
+    *m_pWriter << result.line;
+}
+
 //
 void runSimulation()
 {
@@ -985,25 +1148,7 @@ std::vector<double> simulateSampleKmerDepths(size_t mean_depth, size_t N)
 //
 std::vector<size_t> getPopulationCoverageCount(const std::string& kmer, const BWTIndexSet& indices)
 {
-    //
-    StringVector kmers;
-    kmers.push_back(kmer);
-    kmers.push_back(reverseComplement(kmer));
-    SeqRecordVector records;
-    HapgenUtil::extractHaplotypeReads(kmers, indices, opt::k, false, -1, 100000, &records, NULL);
-
-    // Count the number of reads per samples using their index in the BWT
-    std::vector<size_t> sample_counts(indices.pPopIdx->getNumSamples());
-
-    for(size_t i = 0; i < records.size(); ++i)
-    {
-        std::stringstream parser(records[i].id.substr(4));
-        size_t index;
-        parser >> index;
-        size_t s_idx = indices.pPopIdx->getSampleIndex(index);
-        sample_counts[s_idx]++;
-    }
-    return sample_counts;
+    return BWTAlgorithms::countPopulationCoverage(kmer, indices, 100000);
 }
 
 //
@@ -1012,29 +1157,43 @@ std::vector<double> getSampleMeanKmerDepth(size_t k, const BWTIndexSet& indices)
     size_t N = indices.pPopIdx->getNumSamples();
     std::vector<double> average_counts(N);
     
+    // Draw the k-mers up front so the samples do not depend on the number of threads
     printf("starting sampling\n");
     size_t target_samples = 1000;
-    size_t used_samples = 0;
+    StringVector test_kmers(target_samples);
     for(size_t i = 0; i < target_samples; ++i)
     {
-        if(i % 100 == 0)
-            printf("sampling iteration %zu\n", i);
-
-        std::string r_str = BWTAlgorithms::sampleRandomString(indices.pBWT);
-
         // We use the first k-mer in the read
-        std::string test_kmer = r_str.substr(0, k);
+        std::string r_str = BWTAlgorithms::sampleRandomString(indices.pBWT);
+        test_kmers[i] = r_str.substr(0, k);
+    }
 
+    // The counts of the k-mers are independent of each other.
+    // Screened out k-mers are left with an empty count vector.
+    std::vector<std::vector<size_t> > sample_counts(target_samples);
+#if HAVE_OPENMP
+    omp_set_num_threads(opt::numThreads);
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for(int i = 0; i < (int)target_samples; ++i)
+    {
         // Screen out ultra-low depth k-mers
-        size_t count = BWTAlgorithms::countSequenceOccurrences(test_kmer, indices);
+        size_t count = BWTAlgorithms::countSequenceOccurrences(test_kmers[i], indices);
         if(count < 5)
             continue;
 
-        //
-        std::vector<size_t> incoming_counts = getPopulationCoverageCount(test_kmer, indices);
+        sample_counts[i] = getPopulationCoverageCount(test_kmers[i], indices);
+    }
 
-        for(size_t i = 0; i < incoming_counts.size(); ++i)
-            average_counts[i] += incoming_counts[i];
+    size_t used_samples = 0;
+    for(size_t i = 0; i < target_samples; ++i)
+    {
+        const std::vector<size_t>& incoming_counts = sample_counts[i];
+        if(incoming_counts.empty())
+            continue;
+
+        for(size_t j = 0; j < incoming_counts.size(); ++j)
+            average_counts[j] += incoming_counts[j];
         used_samples += 1;
     }
 
@@ -1049,6 +1208,100 @@ std::vector<double> getSampleMeanKmerDepth(size_t k, const BWTIndexSet& indices)
     return average_counts;
 }
 
+//
+std::vector<double> getCachedSampleMeanKmerDepth(const std::string& prefix, size_t k, const BWTIndexSet& indices)
+{
+    std::vector<double> depths;
+    if(readSampleDepthsCache(prefix, k, indices, depths))
+    {
+        std::cout << "Loaded sample depths from " << prefix + POPDEPTH_EXT << "\n";
+        return depths;
+    }
+
+    depths = getSampleMeanKmerDepth(k, indices);
+    writeSampleDepthsCache(prefix, k, indices, depths);
+    return depths;
+}
+
+// The way the coverage of a k-mer is counted, either reads or occurrences
+// when the population color index is used
+static std::string getCoverageCountMode(const BWTIndexSet& indices)
+{
+    return indices.pPopColors != NULL ? "occurrences" : "reads";
+}
+
+// The depth file starts with the k-mer size, the coverage counting mode and 
+// the shape of the index the depths were computed from, followed by the depth 
+// of each sample. The file is only used if these match the loaded index and 
+// it is not older than the index files that were used to count the coverage.
+bool readSampleDepthsCache(const std::string& prefix, size_t k, const BWTIndexSet& indices, std::vector<double>& depths)
+{
+    std::string filename = prefix + POPDEPTH_EXT;
+    struct stat cache_s;
+    if(stat(filename.c_str(), &cache_s) != 0)
+        return false;
+
+    std::string index_files[3] = { prefix + BWT_EXT, prefix + POPIDX_EXT, prefix + POPCOLOR_EXT };
+    size_t num_index_files = indices.pPopColors != NULL ? 3 : 2;
+    for(size_t i = 0; i < num_index_files; ++i)
+    {
+        struct stat index_s;
+        if(stat(index_files[i].c_str(), &index_s) == 0 && index_s.st_mtime > cache_s.st_mtime)
+        {
+            std::cout << "Sample depths in " << filename << " are older than " << index_files[i] << ", recomputing\n";
+            return false;
+        }
+    }
+
+    std::ifstream stream(filename.c_str());
+    size_t cache_k = 0;
+    std::string mode;
+    size_t num_samples = 0;
+    size_t num_strings = 0;
+    size_t bw_len = 0;
+    stream >> cache_k >> mode >> num_samples >> num_strings >> bw_len;
+    if(!stream.good() || cache_k != k || mode != getCoverageCountMode(indices) ||
+       num_samples != indices.pPopIdx->getNumSamples() ||
+       num_strings != indices.pBWT->getNumStrings() ||
+       bw_len != indices.pBWT->getBWLen())
+    {
+        std::cout << "Sample depths in " << filename << " do not match the index, recomputing\n";
+        return false;
+    }
+
+    depths.clear();
+    double d;
+    while(depths.size() < num_samples && stream >> d)
+        depths.push_back(d);
+
+    if(depths.size() != num_samples)
+    {
+        std::cout << "Sample depths in " << filename << " are truncated, recomputing\n";
+        return false;
+    }
+    return true;
+}
+
+//
+void writeSampleDepthsCache(const std::string& prefix, size_t k, const BWTIndexSet& indices, const std::vector<double>& depths)
+{
+    std::string filename = prefix + POPDEPTH_EXT;
+    std::ofstream stream(filename.c_str());
+    if(!stream.good())
+    {
+        std::cerr << "Warning: could not write sample depths to " << filename << "\n";
+        return;
+    }
+
+    stream << k << "\t" << getCoverageCountMode(indices) << "\t" << indices.pPopIdx->getNumSamples() << "\t" 
+           << indices.pBWT->getNumStrings() << "\t" << indices.pBWT->getBWLen() << "\n";
+
+    // Write the depths at full precision so the loaded depths are the computed ones
+    stream << std::setprecision(17);
+    for(size_t i = 0; i < depths.size(); ++i)
+        stream << depths[i] << "\n";
+}
+
 // 
 // Handle command line arguments
 //
@@ -1066,6 +1319,7 @@ void parseHaplotypeFilterOptions(int argc, char** argv)
             case 'r': arg >> opt::readsFile; break;
             case OPT_REFERENCE: arg >> opt::referenceFile; break;
             case OPT_HAPLOID: opt::bHaploid = true; break;
+            case OPT_POPCOLORS: opt::bUsePopColors = true; break;
             case '?': die = true; break;
             case 'v': opt::verbose++; break;
             case OPT_HELP:
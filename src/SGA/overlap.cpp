@@ -43,6 +43,9 @@ size_t computeHitsParallel(int numThreads, const std::string& prefix, const std:
 //
 void convertHitsToASQG(const std::string& indexPrefix, const StringVector& hitsFilenames, std::ostream* pASQGWriter);
 
+// Warn if entries of the duplicate cache were not released by all the copies of their read
+void checkDuplicateCacheEmpty(const OverlapDuplicateCache& duplicateCache);
+
 
 //
 // Getopt
@@ -75,6 +78,13 @@ static const char *OVERLAP_USAGE_MESSAGE =
 "                                       is specified (see above). This parameter defaults to the same value as --seed-length\n"
 "      -d, --sample-rate=N              sample the symbol counts every N symbols in the FM-index. Higher values use significantly\n"
 "                                       less memory at the cost of higher runtime. This value must be a power of 2 (default: 128)\n"
+"          --max-irreducible-steps=N    abort the irreducible overlap computation for reads that require more than N\n"
+"                                       block extensions, for example reads from highly repetitive regions. These reads\n"
+"                                       are written without overlaps (default: no limit)\n"
+"          --cache-duplicates           compute the overlaps of reads that have identical copies in the input only once\n"
+"                                       and reuse them for the copies. This is faster for libraries with many duplicate\n"
+"                                       reads. The overlaps of a read are kept in memory until all its copies have been\n"
+"                                       processed. Ignored with --target-file\n"
 "\nReport bugs to " PACKAGE_BUGREPORT "\n\n";
 
 static const char* PROGRAM_IDENT =
@@ -96,11 +106,13 @@ namespace opt
     static int sampleRate = BWT::DEFAULT_SAMPLE_RATE_SMALL;
     static bool bIrreducibleOnly = true;
     static bool bExactIrreducible = false;
+    static int maxIrreducibleSteps = -1;
+    static bool bCacheDuplicates = false;
 }
 
 static const char* shortopts = "m:d:e:t:l:s:o:f:vix";
 
-enum { OPT_HELP = 1, OPT_VERSION, OPT_EXACT };
+enum { OPT_HELP = 1, OPT_VERSION, OPT_EXACT, OPT_MAXIRREDUCIBLESTEPS, OPT_CACHEDUPLICATES };
 
 static const struct option longopts[] = {
     { "verbose",     no_argument,       NULL, 'v' },
@@ -115,6 +127,8 @@ static const struct option longopts[] = {
     { "seed-stride", required_argument, NULL, 's' },
     { "exhaustive",  no_argument,       NULL, 'x' },
     { "exact",       no_argument,       NULL, OPT_EXACT },
+    { "max-irreducible-steps", required_argument, NULL, OPT_MAXIRREDUCIBLESTEPS },
+    { "cache-duplicates", no_argument, NULL, OPT_CACHEDUPLICATES },
     { "help",        no_argument,       NULL, OPT_HELP },
     { "version",     no_argument,       NULL, OPT_VERSION },
     { NULL, 0, NULL, 0 }
@@ -161,6 +175,7 @@ int overlapMain(int argc, char** argv)
 
     pOverlapper->setExactModeOverlap(opt::errorRate <= 0.0001);
     pOverlapper->setExactModeIrreducible(opt::errorRate <= 0.0001);
+    pOverlapper->setMaxIrreducibleSteps(opt::maxIrreducibleSteps);
 
     Timer* pTimer = new Timer(PROGRAM_IDENT);
     pBWT->printInfo();
@@ -185,6 +200,9 @@ int overlapMain(int argc, char** argv)
         computeHitsParallel(opt::numThreads, outPrefix, opt::readsFile, pOverlapper, opt::minOverlap, hitsFilenames, pASQGWriter);
     }
 
+    if(opt::maxIrreducibleSteps >= 0)
+        printf("[%s] %zu reads exceeded the irreducible step limit\n", PROGRAM_IDENT, OverlapAlgorithm::getNumAbortedIrreducible());
+
     // Get the number of strings in the BWT, this is used to pre-allocated the read table
     delete pOverlapper;
     delete pBWT; 
@@ -211,7 +229,8 @@ size_t computeHitsSerial(const std::string& prefix, const std::string& readsFile
     std::string filename = prefix + HITS_EXT + GZIP_EXT;
     filenameVec.push_back(filename);
 
-    OverlapProcess processor(filename, pOverlapper, minOverlap);
+    OverlapDuplicateCache duplicateCache;
+    OverlapProcess processor(filename, pOverlapper, minOverlap, opt::bCacheDuplicates ? &duplicateCache : NULL);
     OverlapPostProcess postProcessor(pASQGWriter, pOverlapper);
 
     size_t numProcessed = 
@@ -219,6 +238,13 @@ size_t computeHitsSerial(const std::string& prefix, const std::string& readsFile
                                                             OverlapResult, 
                                                             OverlapProcess, 
                                                             OverlapPostProcess>(readsFile, &processor, &postProcessor);
+
+    if(opt::bCacheDuplicates)
+    {
+        printf("[%s] duplicate cache hits: %zu misses: %zu\n", PROGRAM_IDENT, 
+               duplicateCache.getNumHits(), duplicateCache.getNumMisses());
+        checkDuplicateCacheEmpty(duplicateCache);
+    }
     return numProcessed;
 }
 
@@ -233,6 +259,8 @@ size_t computeHitsParallel(int numThreads, const std::string& prefix, const std:
 {
     std::string filename = prefix + HITS_EXT + GZIP_EXT;
 
+    // The duplicate cache is shared by all the threads
+    OverlapDuplicateCache duplicateCache;
     std::vector<OverlapProcess*> processorVector;
     for(int i = 0; i < numThreads; ++i)
     {
@@ -240,7 +268,8 @@ size_t computeHitsParallel(int numThreads, const std::string& prefix, const std:
         ss << prefix << "-thread" << i << HITS_EXT << GZIP_EXT;
         std::string outfile = ss.str();
         filenameVec.push_back(outfile);
-        OverlapProcess* pProcessor = new OverlapProcess(outfile, pOverlapper, minOverlap);
+        OverlapProcess* pProcessor = new OverlapProcess(outfile, pOverlapper, minOverlap, 
+                                                        opt::bCacheDuplicates ? &duplicateCache : NULL);
         processorVector.push_back(pProcessor);
     }
 
@@ -254,9 +283,26 @@ size_t computeHitsParallel(int numThreads, const std::string& prefix, const std:
                                                               OverlapPostProcess>(readsFile, processorVector, &postProcessor);
     for(int i = 0; i < numThreads; ++i)
         delete processorVector[i];
+
+    if(opt::bCacheDuplicates)
+    {
+        printf("[%s] duplicate cache hits: %zu misses: %zu\n", PROGRAM_IDENT, 
+               duplicateCache.getNumHits(), duplicateCache.getNumMisses());
+        checkDuplicateCacheEmpty(duplicateCache);
+    }
     return numProcessed;
 }
 
+//
+void checkDuplicateCacheEmpty(const OverlapDuplicateCache& duplicateCache)
+{
+    if(duplicateCache.getNumEntries() > 0)
+    {
+        std::cerr << "Warning: " << duplicateCache.getNumEntries() << " entries of the duplicate cache were not " 
+                  << "released, the reads file may not match the index\n";
+    }
+}
+
 //
 void convertHitsToASQG(const std::string& indexPrefix, const StringVector& hitsFilenames, std::ostream* pASQGWriter)
 {
@@ -332,6 +378,8 @@ void parseOverlapOptions(int argc, char** argv)
             case 'd': arg >> opt::sampleRate; break;
             case 'f': arg >> opt::targetFile; break;
             case OPT_EXACT: opt::bExactIrreducible = true; break;
+            case OPT_MAXIRREDUCIBLESTEPS: arg >> opt::maxIrreducibleSteps; break;
+            case OPT_CACHEDUPLICATES: opt::bCacheDuplicates = true; break;
             case 'x': opt::bIrreducibleOnly = false; break;
             case '?': die = true; break;
             case 'v': opt::verbose++; break;
@@ -386,6 +434,14 @@ void parseOverlapOptions(int argc, char** argv)
     // Parse the input filenames
     opt::readsFile = argv[optind++];
 
+    // The copies of a read are counted in the index so the
+    // duplicate cache only works when the reads are overlapped to themselves
+    if(opt::bCacheDuplicates && !opt::targetFile.empty() && opt::targetFile != opt::readsFile)
+    {
+        std::cerr << SUBPROGRAM ": --cache-duplicates cannot be used with --target-file, ignoring\n";
+        opt::bCacheDuplicates = false;
+    }
+
     if(opt::outFile.empty())
     {
         std::string prefix = stripFilename(opt::readsFile);
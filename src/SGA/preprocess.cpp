@@ -15,6 +15,7 @@
 #include "PrimerScreen.h"
 #include "Alphabet.h"
 #include "Quality.h"
+#include "SequenceProcessFramework.h"
 
 static unsigned int DEFAULT_MIN_LENGTH = 40;
 static int LOW_QUALITY_PHRED_SCORE = 3;
@@ -36,6 +37,8 @@ static const char *PREPROCESS_USAGE_MESSAGE =
 "\n"
 "      --help                           display this help and exit\n"
 "      -v, --verbose                    display verbose output\n"
+"      -t, --threads=NUM                use NUM threads to filter the reads (default: 1)\n"
+"                                       The output order is the same as with a single thread.\n"
 "\nInput/Output options:\n"
 "      -o, --out=FILE                   write the reads to FILE (default: stdout)\n"
 "      -p, --pe-mode=INT                0 - do not treat reads as paired (default)\n"
@@ -80,6 +83,7 @@ enum QualityScaling
 namespace opt
 {
     static unsigned int verbose;
+    static int numThreads = 1;
     static std::string outFile;
     static unsigned int qualityTrim = 0;
     static unsigned int hardClip = 0;
@@ -104,13 +108,14 @@ namespace opt
     static std::string adapterR; // adapter sequence reverse
 }
 
-static const char* shortopts = "o:q:m:h:p:r:c:s:f:vi";
+static const char* shortopts = "o:q:m:h:p:r:c:s:f:t:vi";
 
 enum { OPT_HELP = 1, OPT_VERSION, OPT_PERMUTE, OPT_QSCALE, OPT_MINGC, OPT_MAXGC, 
        OPT_DUST, OPT_DUST_THRESHOLD, OPT_SUFFIX, OPT_PHRED64, OPT_OUTPUTORPHANS, OPT_DISABLE_PRIMER };
 
 static const struct option longopts[] = {
     { "verbose",                no_argument,       NULL, 'v' },
+    { "threads",                required_argument, NULL, 't' },
     { "out",                    required_argument, NULL, 'o' },
     { "quality-trim",           required_argument, NULL, 'q' },
     { "quality-filter",         required_argument, NULL, 'f' },
@@ -141,6 +146,111 @@ static int64_t s_numBasesKept = 0;
 static int64_t s_numReadsPrimer = 0;
 static int64_t s_numInvalidPE = 0;
 static int64_t s_numFailedDust = 0;
+static unsigned int s_randomSeed = 0;
+
+// Counts collected while filtering a single read. These are computed
+// by the worker threads and merged into the totals above by the post processor.
+struct PreprocessStats
+{
+    PreprocessStats() : numReadsRead(0), numBasesRead(0), numReadsPrimer(0), numFailedDust(0) {}
+
+    int64_t numReadsRead;
+    int64_t numBasesRead;
+    int64_t numReadsPrimer;
+    int64_t numFailedDust;
+};
+
+// The filtered records for a single read or a read pair.
+// For single-end data only record1/passed1 are used.
+struct PreprocessResult
+{
+    PreprocessResult() : passed1(false), passed2(false) {}
+
+    SeqRecord record1;
+    SeqRecord record2;
+    bool passed1;
+    bool passed2;
+    PreprocessStats stats;
+};
+
+// Generate read pairs from two files (pe-mode 1) or from a
+// single interleaved file (pe-mode 2, pReader1 == pReader2).
+// The pair names are checked and normalized here, on the main thread,
+// so that any warnings are emitted in input order.
+class PreprocessPairGenerator
+{
+    public:
+        PreprocessPairGenerator(SeqReader* pReader1, SeqReader* pReader2) : m_pReader1(pReader1), 
+                                                                            m_pReader2(pReader2), 
+                                                                            m_numConsumed(0) {}
+
+        bool generate(SequenceWorkItemPair& out);
+        inline size_t getNumConsumed() const { return m_numConsumed; }
+
+    private:
+        SeqReader* m_pReader1;
+        SeqReader* m_pReader2;
+        size_t m_numConsumed;
+};
+
+// Apply the filters to a read or read pair. This class is stateless
+// so one instance can be given to each thread.
+class PreprocessProcess
+{
+    public:
+        PreprocessResult process(const SequenceWorkItem& item);
+        PreprocessResult process(const SequenceWorkItemPair& item);
+};
+
+// Write the reads that passed filtering, in the order they were read,
+// and accumulate the statistics.
+class PreprocessPostProcess
+{
+    public:
+        PreprocessPostProcess(std::ostream* pWriter, std::ostream* pOrphanWriter) : m_pWriter(pWriter),
+                                                                                   m_pOrphanWriter(pOrphanWriter) {}
+
+        void process(const SequenceWorkItem& item, const PreprocessResult& result);
+        void process(const SequenceWorkItemPair& item, const PreprocessResult& result);
+
+    private:
+        void addStats(const PreprocessStats& stats);
+
+        std::ostream* m_pWriter;
+        std::ostream* m_pOrphanWriter;
+};
+
+// Run the filters over all the work items of the generator,
+// serially or in parallel depending on the number of threads requested.
+// The progress messages go to stderr as the reads may be written to stdout.
+template<class Input, class Generator>
+void runPreprocess(Generator& generator, PreprocessPostProcess* pPostProcessor)
+{
+    if(opt::numThreads <= 1)
+    {
+        PreprocessProcess processor;
+        SequenceProcessFramework::processWorkSerial<Input, 
+                                                    PreprocessResult, 
+                                                    Generator, 
+                                                    PreprocessProcess, 
+                                                    PreprocessPostProcess>(generator, &processor, pPostProcessor, -1, stderr);
+    }
+    else
+    {
+        std::vector<PreprocessProcess*> processorVector;
+        for(int i = 0; i < opt::numThreads; ++i)
+            processorVector.push_back(new PreprocessProcess);
+
+        SequenceProcessFramework::processWorkParallelPthread<Input, 
+                                                             PreprocessResult, 
+                                                             Generator, 
+                                                             PreprocessProcess, 
+                                                             PreprocessPostProcess>(generator, processorVector, pPostProcessor, -1, stderr);
+
+        for(int i = 0; i < opt::numThreads; ++i)
+            delete processorVector[i];
+    }
+}
 
 //
 // Main
@@ -162,6 +272,7 @@ int preprocessMain(int argc, char** argv)
     std::cerr << "Min length: " << opt::minLength << "\n";
     std::cerr << "Sample freq: " << opt::sampleFreq << "\n";
     std::cerr << "PE Mode: " << opt::peMode << "\n";
+    std::cerr << "Threads: " << opt::numThreads << "\n";
     std::cerr << "Quality scaling: " << opt::qualityScale << "\n";
     std::cerr << "MinGC: " << opt::minGC << "\n";
     std::cerr << "MaxGC: " << opt::maxGC << "\n";
@@ -180,8 +291,10 @@ int preprocessMain(int argc, char** argv)
         std::cerr << "Adapter sequence rev: " << opt::adapterR << "\n";
     }
 
-    // Seed the RNG
-    srand(time(NULL));
+    // Seed the RNG. The seed is also used to derive a per-read
+    // seed for permuting ambiguous bases in the worker threads.
+    s_randomSeed = time(NULL);
+    srand(s_randomSeed);
 
     std::ostream* pWriter;
     if(opt::outFile.empty())
@@ -199,6 +312,8 @@ int preprocessMain(int argc, char** argv)
     if(!opt::orphanFile.empty())
         pOrphanWriter = createWriter(opt::orphanFile);
 
+    PreprocessPostProcess postProcessor(pWriter, pOrphanWriter);
+
     if(opt::peMode == 0)
     {
         // Treat files as SE data
@@ -207,21 +322,8 @@ int preprocessMain(int argc, char** argv)
             std::string filename = argv[optind++];
             std::cerr << "Processing " << filename << "\n\n";
             SeqReader reader(filename, SRF_NO_VALIDATION);
-            SeqRecord record;
-
-            while(reader.get(record))
-            {
-                bool passed = processRead(record);
-                if(passed && samplePass())
-                {
-                    if(!opt::suffix.empty())
-                        record.id.append(opt::suffix);
-
-                    record.write(*pWriter);
-                    ++s_numReadsKept;
-                    s_numBasesKept += record.seq.length();
-                }
-            }
+            WorkItemGenerator<SequenceWorkItem> generator(&reader);
+            runPreprocess<SequenceWorkItem>(generator, &postProcessor);
         }
     }
     else
@@ -260,58 +362,8 @@ int preprocessMain(int argc, char** argv)
                 std::cerr << "Processing interleaved pe file " << filename << "\n";
             }
 
-            SeqRecord record1;
-            SeqRecord record2;
-            while(pReader1->get(record1) && pReader2->get(record2))
-            {
-                // If the names of the records are the same, append a /1 and /2 to them
-                if(record1.id == record2.id)
-                {
-                    if(!opt::suffix.empty())
-                    {
-                        record1.id.append(opt::suffix);
-                        record2.id.append(opt::suffix);
-                    }
-
-                    record1.id.append("/1");
-                    record2.id.append("/2");
-                }
-
-                // Ensure the read names are sensible
-                std::string expectedID2 = getPairID(record1.id);
-                std::string expectedID1 = getPairID(record2.id);
-
-                if(expectedID1 != record1.id || expectedID2 != record2.id)
-                {
-                    std::cerr << "Warning: Pair IDs do not match (expected format /1,/2 or /A,/B)\n";
-                    std::cerr << "Read1 ID: " << record1.id << "\n";
-                    std::cerr << "Read2 ID: " << record2.id << "\n";
-                    s_numInvalidPE += 2;
-                }
-
-                bool passed1 = processRead(record1);
-                bool passed2 = processRead(record2);
-
-                if(!samplePass())
-                    continue;
-
-                if(passed1 && passed2)
-                {
-                    record1.write(*pWriter);
-                    record2.write(*pWriter);
-                    s_numReadsKept += 2;
-                    s_numBasesKept += record1.seq.length();
-                    s_numBasesKept += record2.seq.length();
-                }
-                else if(passed1 && pOrphanWriter != NULL)
-                {
-                    record1.write(*pOrphanWriter);
-                }
-                else if(passed2 && pOrphanWriter != NULL)
-                {
-                    record2.write(*pOrphanWriter);
-                }
-            }
+            PreprocessPairGenerator generator(pReader1, pReader2);
+            runPreprocess<SequenceWorkItemPair>(generator, &postProcessor);
 
             if(pReader2 != pReader1)
             {
@@ -341,12 +393,142 @@ int preprocessMain(int argc, char** argv)
     if(opt::bDustFilter)
         std::cerr << "Number of reads failed dust filter: " << s_numFailedDust << "\n";
     delete pTimer;
+
+    if(opt::numThreads > 1)
+        pthread_exit(NULL);
+
     return 0;
 }
 
+//
+bool PreprocessPairGenerator::generate(SequenceWorkItemPair& out)
+{
+    SeqRecord record1;
+    SeqRecord record2;
+    if(!m_pReader1->get(record1) || !m_pReader2->get(record2))
+        return false;
+
+    // If the names of the records are the same, append a /1 and /2 to them
+    if(record1.id == record2.id)
+    {
+        if(!opt::suffix.empty())
+        {
+            record1.id.append(opt::suffix);
+            record2.id.append(opt::suffix);
+        }
+
+        record1.id.append("/1");
+        record2.id.append("/2");
+    }
+
+    // Ensure the read names are sensible
+    std::string expectedID2 = getPairID(record1.id);
+    std::string expectedID1 = getPairID(record2.id);
+
+    if(expectedID1 != record1.id || expectedID2 != record2.id)
+    {
+        std::cerr << "Warning: Pair IDs do not match (expected format /1,/2 or /A,/B)\n";
+        std::cerr << "Read1 ID: " << record1.id << "\n";
+        std::cerr << "Read2 ID: " << record2.id << "\n";
+        s_numInvalidPE += 2;
+    }
+
+    out.first.idx = m_numConsumed;
+    out.first.read = record1;
+    out.second.idx = m_numConsumed + 1;
+    out.second.read = record2;
+    m_numConsumed += 2;
+    return true;
+}
+
+// Derive the random seed for a read from its index so the
+// result of permuting ambiguous bases does not depend on which
+// thread the read was processed by.
+static unsigned int getReadSeed(size_t idx)
+{
+    return s_randomSeed ^ (unsigned int)(idx * 2654435761u);
+}
+
+//
+PreprocessResult PreprocessProcess::process(const SequenceWorkItem& item)
+{
+    PreprocessResult result;
+    result.record1 = item.read;
+
+    unsigned int seed = getReadSeed(item.idx);
+    result.passed1 = processRead(result.record1, result.stats, &seed);
+    return result;
+}
+
+//
+PreprocessResult PreprocessProcess::process(const SequenceWorkItemPair& item)
+{
+    PreprocessResult result;
+    result.record1 = item.first.read;
+    result.record2 = item.second.read;
+
+    unsigned int seed1 = getReadSeed(item.first.idx);
+    unsigned int seed2 = getReadSeed(item.second.idx);
+    result.passed1 = processRead(result.record1, result.stats, &seed1);
+    result.passed2 = processRead(result.record2, result.stats, &seed2);
+    return result;
+}
+
+//
+void PreprocessPostProcess::addStats(const PreprocessStats& stats)
+{
+    s_numReadsRead += stats.numReadsRead;
+    s_numBasesRead += stats.numBasesRead;
+    s_numReadsPrimer += stats.numReadsPrimer;
+    s_numFailedDust += stats.numFailedDust;
+}
+
+//
+void PreprocessPostProcess::process(const SequenceWorkItem& /*item*/, const PreprocessResult& result)
+{
+    addStats(result.stats);
+    if(result.passed1 && samplePass())
+    {
+        SeqRecord record = result.record1;
+        if(!opt::suffix.empty())
+            record.id.append(opt::suffix);
+
+        record.write(*m_pWriter);
+        ++s_numReadsKept;
+        s_numBasesKept += record.seq.length();
+    }
+}
+
+//
+void PreprocessPostProcess::process(const SequenceWorkItemPair& /*item*/, const PreprocessResult& result)
+{
+    addStats(result.stats);
+
+    if(!samplePass())
+        return;
+
+    if(result.passed1 && result.passed2)
+    {
+        result.record1.write(*m_pWriter);
+        result.record2.write(*m_pWriter);
+        s_numReadsKept += 2;
+        s_numBasesKept += result.record1.seq.length();
+        s_numBasesKept += result.record2.seq.length();
+    }
+    else if(result.passed1 && m_pOrphanWriter != NULL)
+    {
+        result.record1.write(*m_pOrphanWriter);
+    }
+    else if(result.passed2 && m_pOrphanWriter != NULL)
+    {
+        result.record2.write(*m_pOrphanWriter);
+    }
+}
+
 // Process a single read by quality trimming, filtering
-// returns true if the read should be kept
-bool processRead(SeqRecord& record)
+// returns true if the read should be kept. The counts are
+// added to stats and pSeed is the state used to permute ambiguous bases.
+bool processRead(SeqRecord& record, PreprocessStats& stats, unsigned int* pSeed)
 {
     // let's remove the adapter if the user has requested so
     // before doing any filtering
@@ -386,8 +568,8 @@ bool processRead(SeqRecord& record)
     std::string seqStr = record.seq.toString();
     std::string qualStr = record.qual;
 
-    ++s_numReadsRead;
-    s_numBasesRead += seqStr.size();
+    ++stats.numReadsRead;
+    stats.numBasesRead += seqStr.size();
 
     // If ambiguity codes are present in the sequence
     // and the user wants to keep them, we randomly
@@ -408,7 +590,7 @@ bool processRead(SeqRecord& record)
             std::string possibles = IUPAC::getPossibleSymbols(seqStr[i]);
 
             // select one of the bases at random
-            int j = rand() % possibles.size();
+            int j = rand_r(pSeed) % possibles.size();
             seqStr[i] = possibles[j];
         }
     }
@@ -469,7 +651,7 @@ bool processRead(SeqRecord& record)
 
         if(!bAcceptDust)
         {
-            s_numFailedDust += 1;
+            stats.numFailedDust += 1;
             if(opt::verbose >= 1)
             {
                 printf("Failed dust: %s %s %lf\n", record.id.c_str(),
@@ -494,7 +676,7 @@ bool processRead(SeqRecord& record)
         bool containsPrimer = PrimerScreen::containsPrimer(seqStr);
         if(containsPrimer)
         {
-            ++s_numReadsPrimer;
+            ++stats.numReadsPrimer;
             return false;
         }
     }
@@ -519,36 +701,41 @@ bool samplePass()
 }
 
 // Perform a soft-clipping of the sequence by removing low quality bases from the
-// 3' end using Heng Li's algorithm from bwa
+// 3' end using Heng Li's algorithm from bwa. The suffix sums of (qualTrim - q)
+// are computed directly on the phred33 characters and the read is cut at
+// the position that maximizes the sum. The strings are truncated in place.
 void softClip(int qualTrim, std::string& seq, std::string& qual)
 {
     assert(seq.size() == qual.size());
+    if(qual.empty())
+        return;
+
+    const char* pQual = qual.data();
+    int i = qual.length() - 1;
 
-    int endpoint = 0; // not inclusive
-    int max = 0;
-    int i = seq.length() - 1;
-    int terminalScore = Quality::char2phred(qual[i]);
     // Only perform soft-clipping if the last base has qual less than qualTrim
+    int terminalScore = Quality::char2phred(pQual[i]);
     if(terminalScore >= qualTrim)
         return;
 
+    // qualTrim - (c - 33) == threshold - c for a phred33 character c
+    const int threshold = qualTrim + 33;
+    int endpoint = 0; // not inclusive
+    int max = 0;
     int subSum = 0;
-    while(i >= 0)
+    for(; i >= 0; --i)
     {
-        int ps = Quality::char2phred(qual[i]);
-        int score = qualTrim - ps;
-        subSum += score;
+        subSum += threshold - static_cast<uint8_t>(pQual[i]);
         if(subSum > max)
         {
             max = subSum;
             endpoint = i;
         }
-        --i;
     }
 
     // Clip the read
-    seq = seq.substr(0, endpoint);
-    qual = qual.substr(0, endpoint);
+    seq.resize(endpoint);
+    qual.resize(endpoint);
 }
 
 // Count the number of low quality bases in the read
@@ -556,13 +743,12 @@ int countLowQuality(const std::string& seq, const std::string& qual)
 {
     assert(seq.size() == qual.size());
 
+    // Compare the phred33 characters directly against the threshold
+    const uint8_t maxLowQuality = LOW_QUALITY_PHRED_SCORE + 33;
+    const char* pQual = qual.data();
     int sum = 0;
     for(size_t i = 0; i < seq.length(); ++i)
-    {
-        int ps = Quality::char2phred(qual[i]);
-        if(ps <= LOW_QUALITY_PHRED_SCORE)
-            ++sum;
-    }
+        sum += static_cast<uint8_t>(pQual[i]) <= maxLowQuality;
     return sum;
 }
 
@@ -602,6 +788,7 @@ void parsePreprocessOptions(int argc, char** argv)
             case 's': arg >> opt::sampleFreq; break;
             case '?': die = true; break;
             case 'v': opt::verbose++; break;
+            case 't': arg >> opt::numThreads; break;
             case OPT_DUST_THRESHOLD: arg >> opt::dustThreshold; opt::bDustFilter = true; break;
             case OPT_SUFFIX: arg >> opt::suffix; break;
             case OPT_MINGC: arg >> opt::minGC; opt::bFilterGC = true; break;
@@ -626,6 +813,12 @@ void parsePreprocessOptions(int argc, char** argv)
         die = true;
     }
 
+    if(opt::numThreads <= 0)
+    {
+        std::cerr << SUBPROGRAM ": invalid number of threads: " << opt::numThreads << "\n";
+        die = true;
+    }
+
     if (die)
     {
         std::cout << "\n" << PREPROCESS_USAGE_MESSAGE;
@@ -12,10 +12,12 @@
 #include "config.h"
 #include "Quality.h"
 
+struct PreprocessStats;
+
 // functions
 int preprocessMain(int argc, char** argv);
 void parsePreprocessOptions(int argc, char** argv);
-bool processRead(SeqRecord& record);
+bool processRead(SeqRecord& record, PreprocessStats& stats, unsigned int* pSeed);
 bool samplePass();
 void softClip(int qualTrim, std::string& seq, std::string& qual);
 int countLowQuality(const std::string& seq, const std::string& qual);
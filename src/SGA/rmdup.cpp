@@ -18,13 +18,6 @@
 #include "RmdupProcess.h"
 #include "BWTDiskConstruction.h"
 
-// functions
-size_t computeRmdupHitsSerial(const std::string& prefix, const std::string& readsFile, 
-                              const OverlapAlgorithm* pOverlapper, StringVector& filenameVec);
- 
-size_t computeRmdupHitsParallel(int numThreads, const std::string& prefix, const std::string& readsFile, 
-                                const OverlapAlgorithm* pOverlapper, StringVector& filenameVec);
-
 //
 // Getopt
 //
@@ -38,6 +31,8 @@ SUBPROGRAM " Version " PACKAGE_VERSION "\n"
 static const char *RMDUP_USAGE_MESSAGE =
 "Usage: " PACKAGE_NAME " " SUBPROGRAM " [OPTION] ... READFILE\n"
 "Remove duplicate reads from the data set.\n"
+"The IDs of the kept reads are written to a bit vector in OUTPREFIX.kept, which\n"
+"maps read IDs in the original index to read IDs in the rebuilt index.\n"
 "\n"
 "  -v, --verbose                        display verbose output\n"
 "      --help                           display this help and exit\n"
@@ -97,96 +92,12 @@ int rmdupMain(int argc, char** argv)
 
 void rmdup()
 {
-    StringVector hitsFilenames;
     BWT* pBWT = new BWT(opt::prefix + BWT_EXT, opt::sampleRate);
     BWT* pRBWT = new BWT(opt::prefix + RBWT_EXT, opt::sampleRate);
     OverlapAlgorithm* pOverlapper = new OverlapAlgorithm(pBWT, pRBWT, 
                                                          opt::errorRate, 0, 
                                                          0, false);
-    Timer* pTimer = new Timer(PROGRAM_IDENT);
-    if(opt::numThreads <= 1)
-    {
-        printf("[%s] starting serial-mode overlap computation\n", PROGRAM_IDENT);
-        computeRmdupHitsSerial(opt::prefix, opt::readsFile, pOverlapper, hitsFilenames);
-    }
-    else
-    {
-        printf("[%s] starting parallel-mode overlap computation with %d threads\n", PROGRAM_IDENT, opt::numThreads);
-        computeRmdupHitsParallel(opt::numThreads, opt::prefix, opt::readsFile, pOverlapper, hitsFilenames);
-    }
-
-    delete pOverlapper;
-    delete pBWT; 
-    delete pRBWT;
-    delete pTimer;
-    
-    std::string out_prefix = stripFilename(opt::outFile);
-    std::string dupsFile = parseDupHits(hitsFilenames, out_prefix);
-
-    // Rebuild the indices without the duplicated sequences
-    if(opt::bReindex)
-    {
-        std::cout << "Rebuilding indices without duplicated reads\n";
-        removeReadsFromIndices(opt::prefix, dupsFile, out_prefix, BWT_EXT, SAI_EXT, false, opt::numThreads);
-        removeReadsFromIndices(opt::prefix, dupsFile, out_prefix, RBWT_EXT, RSAI_EXT, true, opt::numThreads);
-    }
-}
-
-// Compute the hits for each read in the input file without threading
-// Return the number of reads processed
-size_t computeRmdupHitsSerial(const std::string& prefix, const std::string& readsFile, 
-                              const OverlapAlgorithm* pOverlapper, StringVector& filenameVec)
-{
-    std::string filename = prefix + RMDUPHITS_EXT + GZIP_EXT;
-    filenameVec.push_back(filename);
-
-    RmdupProcess processor(filename, pOverlapper);
-    RmdupPostProcess postProcessor;
-
-    size_t numProcessed = 
-           SequenceProcessFramework::processSequencesSerial<SequenceWorkItem,
-                                                            OverlapResult, 
-                                                            RmdupProcess, 
-                                                            RmdupPostProcess>(readsFile, &processor, &postProcessor);
-    return numProcessed;
-}
 
-// Compute the hits for each read in the SeqReader file with threading
-// The way this works is we create a vector of numThreads OverlapProcess pointers and 
-// pass this to the SequenceProcessFragmework which wraps the processes
-// in threads and distributes the reads to each thread.
-// The number of reads processsed is returned
-size_t computeRmdupHitsParallel(int numThreads, const std::string& prefix, const std::string& readsFile, 
-                                const OverlapAlgorithm* pOverlapper, StringVector& filenameVec)
-{
-    std::string filename = prefix + RMDUPHITS_EXT + GZIP_EXT;
-
-    std::vector<RmdupProcess*> processorVector;
-    for(int i = 0; i < numThreads; ++i)
-    {
-        std::stringstream ss;
-        ss << prefix << "-thread" << i << RMDUPHITS_EXT << GZIP_EXT;
-        std::string outfile = ss.str();
-        filenameVec.push_back(outfile);
-        RmdupProcess* pProcessor = new RmdupProcess(outfile, pOverlapper);
-        processorVector.push_back(pProcessor);
-    }
-
-    // The post processing is performed serially so only one post processor is created
-    RmdupPostProcess postProcessor;
-    
-    size_t numProcessed = 
-           SequenceProcessFramework::processSequencesParallel<SequenceWorkItem,
-                                                              OverlapResult, 
-                                                              RmdupProcess, 
-                                                              RmdupPostProcess>(readsFile, processorVector, &postProcessor);
-    for(int i = 0; i < numThreads; ++i)
-        delete processorVector[i];
-    return numProcessed;
-}
-
-std::string parseDupHits(const StringVector& hitsFilenames, const std::string& out_prefix)
-{
     // Load the suffix array index and the reverse suffix array index
     // Note these are not the full suffix arrays
     SuffixArray* pFwdSAI = new SuffixArray(opt::prefix + SAI_EXT);
@@ -200,142 +111,63 @@ std::string parseDupHits(const StringVector& hitsFilenames, const std::string& o
     // instead. This allows us to avoid loading the read names.
     ReadInfoTable* pRIT = new ReadInfoTable(opt::readsFile, pFwdSAI->getNumStrings(), RIO_NUMERICID);
 
+    std::string out_prefix = stripFilename(opt::outFile);
     std::string outFile = out_prefix + ".fa";
-    std::string dupFile = out_prefix + ".dups.fa";
+    std::string dupsFile = out_prefix + ".dups.fa";
     std::ostream* pWriter = createWriter(outFile);
-    std::ostream* pDupWriter = createWriter(dupFile);
+    std::ostream* pDupWriter = createWriter(dupsFile);
 
-    size_t substringRemoved = 0;
-    size_t identicalRemoved = 0;
-    size_t kept = 0;
-    size_t buffer_size = SequenceProcessFramework::BUFFER_SIZE;
+    // The duplicates are resolved by the threads and the reads are
+    // written by the post processor in their original order, in
+    // a single pass over the reads.
+    RmdupStreamPostProcess postProcessor(pWriter, pDupWriter);
 
-    // The reads must be output in their original ordering.
-    // The hits are in the blocks of buffer_size items. We read
-    // buffer_size items from the first hits file, then buffer_size
-    // from the second and so on until all the hits have been processed.
-    size_t num_files = hitsFilenames.size();
-    std::vector<std::istream*> reader_vec(num_files, 0);
-
-    for(size_t i = 0; i < num_files; ++i)
-    {
-        std::cout << "Opening " << hitsFilenames[i] << "\n";
-        reader_vec[i] = createReader(hitsFilenames[i]);
-    }
-
-    bool done = false;
-    size_t currReaderIdx = 0;
-    size_t numRead = 0;
-    size_t numReadersDone = 0;
-    std::string line;
-
-    while(!done)
+    Timer* pTimer = new Timer(PROGRAM_IDENT);
+    if(opt::numThreads <= 1)
     {
-        // Parse a line from the current file
-        bool valid = getline(*reader_vec[currReaderIdx], line);
-        ++numRead;
-        // Deal with switching the active reader and the end of files
-        if(!valid || numRead == buffer_size)
-        {
-            // Switch the reader
-            currReaderIdx = (currReaderIdx + 1) % num_files;
-            numRead = 0;
-
-            // Break once all the readers are invalid
-            if(!valid)
-            {
-                ++numReadersDone;
-                if(numReadersDone == num_files)
-                {
-                    done = true;
-                    break;
-                }
-            }
-        }
-
-        // Parse the data
-        if(valid)
-        {
-            std::string id;
-            std::string sequence;
-            std::string hitsStr;
-            size_t readIdx;
-            size_t numCopies;
-            bool isSubstring;
-
-            std::stringstream parser(line);
-            parser >> id;
-            parser >> sequence;
-            getline(parser, hitsStr);
-
-            OverlapVector ov;
-            OverlapCommon::parseHitsString(hitsStr, pRIT, pRIT, pFwdSAI, pRevSAI, true, readIdx, numCopies, ov, isSubstring);
-            
-            bool isContained = false;
-            if(isSubstring)
-            {
-                ++substringRemoved;
-                isContained = true;
-            }
-            else
-            {
-                for(OverlapVector::iterator iter = ov.begin(); iter != ov.end(); ++iter)
-                {
-                    if(iter->isContainment() && iter->getContainedIdx() == 0)
-                    {
-                        // This read is contained by some other read
-                        ++identicalRemoved;
-                        isContained = true;
-                        break;
-                    }
-                }
-            }
-
-            SeqItem item = {id, sequence};
-            std::stringstream meta;
-            meta << id << " NumDuplicates=" << numCopies;
-
-            if(isContained)
-            {
-                // The read's index in the sequence data base
-                // is needed when removing it from the FM-index.
-                // In the output fasta, we set the reads ID to be the index
-                // and record its old id in the fasta header.
-                std::stringstream newID;
-                newID << item.id << ",seqrank=" << readIdx;
-                item.id = newID.str();
-
-                // Write some metadata with the fasta record
-                item.write(*pDupWriter, meta.str());
-            }
-            else
-            {
-                ++kept;
-                // Write the read
-                item.write(*pWriter, meta.str());
-            }
-        }
+        printf("[%s] starting serial-mode duplicate computation\n", PROGRAM_IDENT);
+        RmdupStreamProcess processor(pOverlapper, pFwdSAI, pRevSAI, pRIT);
+        SequenceProcessFramework::processSequencesSerial<SequenceWorkItem,
+                                                         RmdupResult, 
+                                                         RmdupStreamProcess, 
+                                                         RmdupStreamPostProcess>(opt::readsFile, &processor, &postProcessor);
     }
-
-    for(size_t i = 0; i < num_files; ++i)
+    else
     {
-        delete reader_vec[i];
-        unlink(hitsFilenames[i].c_str());
+        printf("[%s] starting parallel-mode duplicate computation with %d threads\n", PROGRAM_IDENT, opt::numThreads);
+        std::vector<RmdupStreamProcess*> processorVector;
+        for(unsigned int i = 0; i < opt::numThreads; ++i)
+            processorVector.push_back(new RmdupStreamProcess(pOverlapper, pFwdSAI, pRevSAI, pRIT));
+
+        SequenceProcessFramework::processSequencesParallel<SequenceWorkItem,
+                                                           RmdupResult, 
+                                                           RmdupStreamProcess, 
+                                                           RmdupStreamPostProcess>(opt::readsFile, processorVector, &postProcessor);
+        for(unsigned int i = 0; i < opt::numThreads; ++i)
+            delete processorVector[i];
     }
 
-    
-    printf("[%s] Removed %zu substring reads\n", PROGRAM_IDENT, substringRemoved);
-    printf("[%s] Removed %zu identical reads\n", PROGRAM_IDENT, identicalRemoved);
-    printf("[%s] Kept %zu reads\n", PROGRAM_IDENT, kept);
+    printf("[%s] Removed %zu substring reads\n", PROGRAM_IDENT, postProcessor.getNumSubstringRemoved());
+    printf("[%s] Removed %zu identical reads\n", PROGRAM_IDENT, postProcessor.getNumIdenticalRemoved());
+    printf("[%s] Kept %zu reads\n", PROGRAM_IDENT, postProcessor.getNumKept());
 
-    // Delete allocated data
-    delete pFwdSAI;
-    delete pRevSAI;
-    delete pRIT;
     delete pWriter;
     delete pDupWriter;
+    delete pRIT;
+    delete pFwdSAI;
+    delete pRevSAI;
+    delete pOverlapper;
+    delete pBWT; 
+    delete pRBWT;
+    delete pTimer;
 
-    return dupFile;
+    // Rebuild the indices without the duplicated sequences
+    if(opt::bReindex)
+    {
+        std::cout << "Rebuilding indices without duplicated reads\n";
+        removeReadsFromIndices(opt::prefix, dupsFile, out_prefix, BWT_EXT, SAI_EXT, false, opt::numThreads, out_prefix + KEPT_EXT);
+        removeReadsFromIndices(opt::prefix, dupsFile, out_prefix, RBWT_EXT, RSAI_EXT, true, opt::numThreads);
+    }
 }
 
 // 
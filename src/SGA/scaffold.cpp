@@ -29,6 +29,7 @@ static const char *SCAFFOLD_USAGE_MESSAGE =
 "\n"
 "      --help                           display this help and exit\n"
 "      -v, --verbose                    display verbose output\n"
+"      -t, --threads=NUM                use NUM threads to load the distance estimates and check the links (default: 1)\n"
 "          --pe=FILE                    load links derived from paired-end (short insert) libraries from FILE\n"
 "          --mate-pair=FILE             load links derived from mate-pair (long insert) libraries from FILE\n"
 "      -m, --min-length=N               only use contigs at least N bp in length to build scaffolds (default: no minimun).\n"
@@ -50,6 +51,7 @@ static const char *SCAFFOLD_USAGE_MESSAGE =
 namespace opt
 {
     static unsigned int verbose;
+    static int numThreads = 1;
     static std::string contigsFile;
     static StringVector peDistanceEstFiles;
     static StringVector mateDistanceEstFiles;
@@ -64,12 +66,13 @@ namespace opt
     static int minContigLength = 0;
 }
 
-static const char* shortopts = "vm:a:u:r:o:g:s:c:";
+static const char* shortopts = "vm:a:u:r:o:g:s:c:t:";
 
 enum { OPT_HELP = 1, OPT_VERSION, OPT_PE, OPT_MATEPAIR, OPT_CUTCONFLICT, OPT_STRICT };
 
 static const struct option longopts[] = {
     { "verbose",            no_argument,       NULL, 'v' },
+    { "threads",            required_argument, NULL, 't' },
     { "min-length",         required_argument, NULL, 'm' },
     { "asgq-file",          required_argument, NULL, 'g' }, 
     { "astatistic-file",    required_argument, NULL, 'a' },
@@ -102,10 +105,10 @@ int scaffoldMain(int argc, char** argv)
     graph.loadVertices(opt::contigsFile, opt::minContigLength);
 
     for(size_t i = 0; i < opt::peDistanceEstFiles.size(); ++i)
-        graph.loadDistanceEstimateEdges(opt::peDistanceEstFiles[i], false, opt::verbose);
+        graph.loadDistanceEstimateEdges(opt::peDistanceEstFiles[i], false, opt::verbose, opt::numThreads);
     
     for(size_t i = 0; i < opt::mateDistanceEstFiles.size(); ++i)
-        graph.loadDistanceEstimateEdges(opt::mateDistanceEstFiles[i], true, opt::verbose);
+        graph.loadDistanceEstimateEdges(opt::mateDistanceEstFiles[i], true, opt::verbose, opt::numThreads);
 
     // Load the a-stat data and mark vertices as unique and repeat
     if(!opt::astatFile.empty())
@@ -135,7 +138,7 @@ int scaffoldMain(int argc, char** argv)
     {
         std::cout << "Performing strict resolutions\n";
         ScaffoldTransitiveReductionVisitor trVisit;
-        graph.visit(trVisit);
+        graph.visitParallel(trVisit, opt::numThreads);
     
         // Check for cycles in the graph
         ScaffoldAlgorithms::destroyStrictCycles(&graph, "scaffold.cycles.out");
@@ -153,12 +156,12 @@ int scaffoldMain(int argc, char** argv)
         if(opt::maxSVSize > 0)
         {
             ScaffoldSVVisitor svVisit(opt::maxSVSize);
-            graph.visit(svVisit);
+            graph.visitParallel(svVisit, opt::numThreads);
         }
 
         // Break any links in the graph that are inconsistent
         ScaffoldLinkValidator linkValidator(100, 0.05f, opt::verbose);
-        graph.visit(linkValidator);
+        graph.visitParallel(linkValidator, opt::numThreads);
         graph.deleteVertices(SVC_REPEAT);
         
         // Check for cycles in the graph using the old cycle finding algorithm
@@ -193,6 +196,7 @@ void parseScaffoldOptions(int argc, char** argv)
         {
             case '?': die = true; break;
             case 'v': opt::verbose++; break;
+            case 't': arg >> opt::numThreads; break;
             case 'm': arg >> opt::minContigLength; break;
             case 'a': arg >> opt::astatFile; break;
             case 'g': arg >> opt::asqgFile; break;
@@ -228,6 +232,12 @@ void parseScaffoldOptions(int argc, char** argv)
         die = true;
     }
 
+    if(opt::numThreads <= 0)
+    {
+        std::cerr << SUBPROGRAM ": invalid number of threads: " << opt::numThreads << "\n";
+        die = true;
+    }
+
     if (die) 
     {
         std::cout << "\n" << SCAFFOLD_USAGE_MESSAGE;
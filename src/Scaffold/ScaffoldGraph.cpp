@@ -130,94 +130,59 @@ void ScaffoldGraph::loadVertices(const std::string& filename, int minLength)
 }
 
 // 
-void ScaffoldGraph::loadDistanceEstimateEdges(const std::string& filename, bool isMatePair, int verbose)
+void ScaffoldGraph::loadDistanceEstimateEdges(const std::string& filename, bool isMatePair, int verbose, int numThreads)
 {
     std::cout << "Reading distance estimates from " << filename << "\n";
     std::istream* pReader = createReader(filename);
     std::string line;
 
-    while(getline(*pReader, line))
+    // The lines are read in batches. The batch is parsed in parallel
+    // then the links are added to the graph in the order they appear
+    // in the file so the graph does not depend on the number of threads
+    const size_t BATCH_SIZE = 4096;
+    StringVector lines;
+    lines.reserve(BATCH_SIZE);
+    std::vector<DistanceEstimateLinkVector> links;
+    bool done = false;
+    while(!done)
     {
-        assert(line.substr(0,4) != "Mate");
-        StringVector fields = split(line, ' ');
-        assert(fields.size() >= 1);
-
-        std::string rootID = fields[0];
-        EdgeDir currDir = ED_SENSE; // abyss distance estimate outputs the sense contigs first
-
-        for(size_t i = 1; i < fields.size(); ++i)
+        lines.clear();
+        while(lines.size() < BATCH_SIZE && getline(*pReader, line))
+            lines.push_back(line);
+        done = lines.size() < BATCH_SIZE;
+
+        links.clear();
+        links.resize(lines.size());
+        if(numThreads <= 1 || lines.size() < 2)
         {
-            std::string record = fields[i];
-            if(record == ";")
-            {
-                currDir = !currDir;
-                continue;
-            }
-
-            std::string id;
-            EdgeComp comp;
-            int distance;
-            int numPairs;
-            double stdDev;
-            parseDERecord(record, id, comp, distance, numPairs, stdDev);
-
-            // Get the vertices that are linked
-            ScaffoldVertex* pVertex1 = getVertex(rootID);
-            ScaffoldVertex* pVertex2 = getVertex(id);
-
-            if(pVertex1 != NULL && pVertex2 != NULL)
+            for(size_t i = 0; i < lines.size(); ++i)
+                parseDistanceEstimateLine(lines[i], links[i]);
+        }
+        else
+        {
+            DistanceEstimateWork work;
+            work.pGraph = this;
+            work.pLines = &lines;
+            work.pLinks = &links;
+            work.next = 0;
+
+            std::vector<pthread_t> threads(numThreads - 1);
+            for(size_t i = 0; i < threads.size(); ++i)
             {
-                if(pVertex1 == pVertex2)
-                {
-                    std::cout << "Self-edges not allowed\n";
-                    assert(false);
-                    continue;
-                }
-
-                ScaffoldLink link1(id, currDir, comp, distance, stdDev, numPairs, pVertex2->getSeqLen(), SLT_DISTANCEEST);
-                ScaffoldLink link2(rootID, !correctDir(currDir, comp), comp, distance, stdDev, numPairs, pVertex1->getSeqLen(), SLT_DISTANCEEST);
-
-                // Check if there already exists a DistanceEstimate edge between these vertices
-                ScaffoldEdge* pEdge = pVertex1->findEdgeTo(id, SLT_DISTANCEEST);
-                if(pEdge != NULL)
-                {
-                    // An edge to this vertex already exists
-                    // If the current estimate is mate-pair link, never overwrite
-                    // the current estimate
-                    if(!isMatePair && pEdge->getLink().stdDev < stdDev)
-                    {
-                        pEdge->setLink(link1);
-                        pEdge->getTwin()->setLink(link2);
-                    }
-                    else
-                    {
-                        if(abs(pEdge->getDistance() - link1.distance) > 100)
-                        {
-                            if(verbose >= 1)
-                            {
-                                printf("LL skipped from %s to %s. Distance1: %d Distance2: %d\n", pVertex1->getID().c_str(), 
-                                                                                                  link1.endpointID.c_str(), 
-                                                                                                  link1.distance, 
-                                                                                                  pEdge->getDistance());
-                            }
-                            pVertex1->setConflictingFlag(true);
-                            pVertex2->setConflictingFlag(true);
-                        }
-                    }
-                }
-                else
+                int ret = pthread_create(&threads[i], NULL, parseDistanceEstimateThread, &work);
+                if(ret != 0)
                 {
-                    ScaffoldEdge* pEdge1 = new ScaffoldEdge(pVertex2, link1);
-                    ScaffoldEdge* pEdge2 = new ScaffoldEdge(pVertex1, link2);
-
-                    pEdge1->setTwin(pEdge2);
-                    pEdge2->setTwin(pEdge1);
-
-                    addEdge(pVertex1, pEdge1);
-                    addEdge(pVertex2, pEdge2);
+                    std::cerr << "Thread creation failed with error " << ret << ", aborting" << std::endl;
+                    exit(EXIT_FAILURE);
                 }
             }
+            parseDistanceEstimateThread(&work);
+            for(size_t i = 0; i < threads.size(); ++i)
+                pthread_join(threads[i], NULL);
         }
+
+        for(size_t i = 0; i < links.size(); ++i)
+            addDistanceEstimateLinks(links[i], isMatePair, verbose);
     }
 
     delete pReader;
@@ -254,9 +219,131 @@ void ScaffoldGraph::loadAStatistic(const std::string& filename)
 }
 
 
+//
+void* ScaffoldGraph::parseDistanceEstimateThread(void* arg)
+{
+    DistanceEstimateWork* pWork = (DistanceEstimateWork*)arg;
+    const size_t BLOCK_SIZE = 64;
+    size_t n = pWork->pLines->size();
+    while(true)
+    {
+        size_t first = __sync_fetch_and_add(&pWork->next, BLOCK_SIZE);
+        if(first >= n)
+            break;
+        size_t last = std::min(first + BLOCK_SIZE, n);
+        for(size_t i = first; i < last; ++i)
+            pWork->pGraph->parseDistanceEstimateLine((*pWork->pLines)[i], (*pWork->pLinks)[i]);
+    }
+    return NULL;
+}
+
+// Parse the links from one line of a distance estimate file. Only the vertex
+// table is read here so this can be called from multiple threads.
+void ScaffoldGraph::parseDistanceEstimateLine(const std::string& line, DistanceEstimateLinkVector& links) const
+{
+    assert(line.substr(0,4) != "Mate");
+    StringVector fields = split(line, ' ');
+    assert(fields.size() >= 1);
+
+    std::string rootID = fields[0];
+    ScaffoldVertex* pVertex1 = getVertex(rootID);
+    EdgeDir currDir = ED_SENSE; // abyss distance estimate outputs the sense contigs first
+
+    for(size_t i = 1; i < fields.size(); ++i)
+    {
+        const std::string& record = fields[i];
+        if(record == ";")
+        {
+            currDir = !currDir;
+            continue;
+        }
+
+        DistanceEstimateLink link;
+        std::string id;
+        parseDERecord(record, id, link.comp, link.distance, link.numPairs, link.stdDev);
+
+        // Get the vertices that are linked
+        link.pVertex1 = pVertex1;
+        link.pVertex2 = getVertex(id);
+        link.dir = currDir;
+
+        if(link.pVertex1 != NULL && link.pVertex2 != NULL)
+            links.push_back(link);
+    }
+}
+
+// Add the parsed links to the graph
+void ScaffoldGraph::addDistanceEstimateLinks(const DistanceEstimateLinkVector& links, bool isMatePair, int verbose)
+{
+    for(size_t i = 0; i < links.size(); ++i)
+    {
+        const DistanceEstimateLink& del = links[i];
+        ScaffoldVertex* pVertex1 = del.pVertex1;
+        ScaffoldVertex* pVertex2 = del.pVertex2;
+
+        if(pVertex1 == pVertex2)
+        {
+            std::cout << "Self-edges not allowed\n";
+            assert(false);
+            continue;
+        }
+
+        VertexID rootID = pVertex1->getID();
+        VertexID id = pVertex2->getID();
+        EdgeDir currDir = del.dir;
+        EdgeComp comp = del.comp;
+        int distance = del.distance;
+        int numPairs = del.numPairs;
+        double stdDev = del.stdDev;
+
+        ScaffoldLink link1(id, currDir, comp, distance, stdDev, numPairs, pVertex2->getSeqLen(), SLT_DISTANCEEST);
+        ScaffoldLink link2(rootID, !correctDir(currDir, comp), comp, distance, stdDev, numPairs, pVertex1->getSeqLen(), SLT_DISTANCEEST);
+
+        // Check if there already exists a DistanceEstimate edge between these vertices
+        ScaffoldEdge* pEdge = pVertex1->findEdgeTo(id, SLT_DISTANCEEST);
+        if(pEdge != NULL)
+        {
+            // An edge to this vertex already exists
+            // If the current estimate is mate-pair link, never overwrite
+            // the current estimate
+            if(!isMatePair && pEdge->getLink().stdDev < stdDev)
+            {
+                pEdge->setLink(link1);
+                pEdge->getTwin()->setLink(link2);
+            }
+            else
+            {
+                if(abs(pEdge->getDistance() - link1.distance) > 100)
+                {
+                    if(verbose >= 1)
+                    {
+                        printf("LL skipped from %s to %s. Distance1: %d Distance2: %d\n", pVertex1->getID().c_str(), 
+                                                                                          link1.endpointID.c_str(), 
+                                                                                          link1.distance, 
+                                                                                          pEdge->getDistance());
+                    }
+                    pVertex1->setConflictingFlag(true);
+                    pVertex2->setConflictingFlag(true);
+                }
+            }
+        }
+        else
+        {
+            ScaffoldEdge* pEdge1 = new ScaffoldEdge(pVertex2, link1);
+            ScaffoldEdge* pEdge2 = new ScaffoldEdge(pVertex1, link2);
+
+            pEdge1->setTwin(pEdge2);
+            pEdge2->setTwin(pEdge1);
+
+            addEdge(pVertex1, pEdge1);
+            addEdge(pVertex2, pEdge2);
+        }
+    }
+}
+
 //
 void ScaffoldGraph::parseDERecord(const std::string& record, std::string& id, 
-                                  EdgeComp& comp, int& distance, int& numPairs, double& stdDev)
+                                  EdgeComp& comp, int& distance, int& numPairs, double& stdDev) const
 {
     StringVector fields = split(record, ',');
     if(fields.size() != 4)
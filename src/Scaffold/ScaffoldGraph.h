@@ -13,6 +13,7 @@
 #ifndef SCAFFOLDGRAPH_H
 #define SCAFFOLDGRAPH_H
 
+#include <pthread.h>
 #include "ScaffoldVertex.h"
 #include "HashMap.h"
 
@@ -26,7 +27,7 @@ class ScaffoldGraph
         ~ScaffoldGraph();
 
         void loadVertices(const std::string& filename, int minLength);
-        void loadDistanceEstimateEdges(const std::string& filename, bool isMatePair, int verbose);
+        void loadDistanceEstimateEdges(const std::string& filename, bool isMatePair, int verbose, int numThreads = 1);
         void loadAStatistic(const std::string& filename);
 
         void addVertex(ScaffoldVertex* pVertex);
@@ -59,12 +60,112 @@ class ScaffoldGraph
             return modified;
         }
 
+        // Visit each vertex in the graph using numThreads threads. The visitor
+        // must provide a Result type, a compute() function that fills in the result
+        // for one vertex without modifying the graph and an apply() function that 
+        // makes the changes. The results are applied serially in the same order
+        // that visit() uses, so the output does not depend on the number of threads.
+        template<typename VF>
+        bool visitParallel(VF& vf, int numThreads)
+        {
+            if(numThreads <= 1)
+                return visit(vf);
+
+            bool modified = false;
+            vf.previsit(this);
+            ScaffoldVertexPtrVector vertices = getAllVertices();
+            std::vector<typename VF::Result> results(vertices.size());
+
+            VisitWork<VF> work;
+            work.pGraph = this;
+            work.pVisitor = &vf;
+            work.pVertices = &vertices;
+            work.pResults = &results;
+            work.next = 0;
+
+            std::vector<pthread_t> threads(numThreads - 1);
+            for(size_t i = 0; i < threads.size(); ++i)
+            {
+                int ret = pthread_create(&threads[i], NULL, visitThread<VF>, &work);
+                if(ret != 0)
+                {
+                    std::cerr << "Thread creation failed with error " << ret << ", aborting" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            // The calling thread works as well
+            visitThread<VF>(&work);
+            for(size_t i = 0; i < threads.size(); ++i)
+                pthread_join(threads[i], NULL);
+
+            for(size_t i = 0; i < vertices.size(); ++i)
+                modified = vf.apply(this, vertices[i], results[i]) || modified;
+            vf.postvisit(this);
+            return modified;
+        }
+
         void writeDot(const std::string& outFile) const;
 
     private:
 
+        // A link parsed from a distance estimate file, before it is added to the graph
+        struct DistanceEstimateLink
+        {
+            ScaffoldVertex* pVertex1;
+            ScaffoldVertex* pVertex2;
+            EdgeDir dir;
+            EdgeComp comp;
+            int distance;
+            int numPairs;
+            double stdDev;
+        };
+        typedef std::vector<DistanceEstimateLink> DistanceEstimateLinkVector;
+
+        // State shared between the threads parsing a batch of distance estimate lines
+        struct DistanceEstimateWork
+        {
+            const ScaffoldGraph* pGraph;
+            const StringVector* pLines;
+            std::vector<DistanceEstimateLinkVector>* pLinks;
+            size_t next;
+        };
+
+        // State shared between the threads of visitParallel
+        template<typename VF>
+        struct VisitWork
+        {
+            ScaffoldGraph* pGraph;
+            VF* pVisitor;
+            const ScaffoldVertexPtrVector* pVertices;
+            std::vector<typename VF::Result>* pResults;
+            size_t next;
+        };
+
+        template<typename VF>
+        static void* visitThread(void* arg)
+        {
+            VisitWork<VF>* pWork = (VisitWork<VF>*)arg;
+            const size_t BLOCK_SIZE = 16;
+            size_t n = pWork->pVertices->size();
+            while(true)
+            {
+                size_t first = __sync_fetch_and_add(&pWork->next, BLOCK_SIZE);
+                if(first >= n)
+                    break;
+                size_t last = std::min(first + BLOCK_SIZE, n);
+                for(size_t i = first; i < last; ++i)
+                    pWork->pVisitor->compute(pWork->pGraph, (*pWork->pVertices)[i], (*pWork->pResults)[i]);
+            }
+            return NULL;
+        }
+
+        static void* parseDistanceEstimateThread(void* arg);
+        void parseDistanceEstimateLine(const std::string& line, DistanceEstimateLinkVector& links) const;
+        void addDistanceEstimateLinks(const DistanceEstimateLinkVector& links, bool isMatePair, int verbose);
+
         void parseDERecord(const std::string& record, std::string& id, 
-                           EdgeComp& comp, int& distance, int& numPairs, double& stdDev);
+                           EdgeComp& comp, int& distance, int& numPairs, double& stdDev) const;
 
         ScaffoldVertexMap m_vertices;
 
@@ -22,8 +22,8 @@ struct ScaffoldDistanceFunction
     }
 };
 
-//
-typedef GraphSearchTree<ScaffoldVertex, ScaffoldEdge, ScaffoldDistanceFunction> ScaffoldSearchTree;
+// The search nodes are taken from the arena of the calling thread
+typedef GraphSearchTree<ScaffoldVertex, ScaffoldEdge, ScaffoldDistanceFunction, GraphSearchArenaAllocator> ScaffoldSearchTree;
 
 //
 struct ScaffoldWalkBuilder
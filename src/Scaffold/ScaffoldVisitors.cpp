@@ -139,11 +139,19 @@ void ScaffoldLinkValidator::previsit(ScaffoldGraph* pGraph)
 }
 
 //
-bool ScaffoldLinkValidator::visit(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex)
+bool ScaffoldLinkValidator::visit(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex)
+{
+    Result result;
+    compute(pGraph, pVertex, result);
+    return apply(pGraph, pVertex, result);
+}
+
+//
+void ScaffoldLinkValidator::compute(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex, Result& result) const
 {
     // Never re-classify repeats
     if(pVertex->getClassification() == SVC_REPEAT)
-        return false;
+        return;
 
     for(size_t idx = 0; idx < ED_COUNT; idx++)
     {
@@ -159,38 +167,49 @@ bool ScaffoldLinkValidator::visit(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVe
             int longestOverlap = group.calculateLongestOverlap();
             group.computeBestOrdering();
             bool overlapCheck = longestOverlap < 400;
-            bool result = overlapCheck;
+            bool passed = overlapCheck;
 
             if(m_verbose >= 1)
             {
                 std::string ambiStr = isAmbiguous ? "ambiguous" : "unambiguous";
                 std::string overStr = overlapCheck ? "good-ordering" : "no-ordering";
-                std::string resultStr = result ? "PASS" : "FAIL";
+                std::string resultStr = passed ? "PASS" : "FAIL";
                 std::string orderStr = group.getBestOrderingString();
-                printf("LV %s %d CL:%d EC:%2.2lf AS:%2.2lf %s %s %s LO:%d BO:%s\n", pVertex->getID().c_str(), 
-                                                                                  (int)idx, 
-                                                                                  (int)pVertex->getSeqLen(), 
-                                                                                  pVertex->getEstCopyNumber(),
-                                                                                  pVertex->getAStatistic(),
-                                                                                  ambiStr.c_str(), 
-                                                                                  overStr.c_str(), 
-                                                                                  resultStr.c_str(), 
-                                                                                  longestOverlap,
-                                                                                  orderStr.c_str());
+                char buffer[256];
+                snprintf(buffer, sizeof(buffer), " %d CL:%d EC:%2.2lf AS:%2.2lf %s %s %s LO:%d", (int)idx, 
+                                                                                            (int)pVertex->getSeqLen(), 
+                                                                                            pVertex->getEstCopyNumber(),
+                                                                                            pVertex->getAStatistic(),
+                                                                                            ambiStr.c_str(), 
+                                                                                            overStr.c_str(), 
+                                                                                            resultStr.c_str(), 
+                                                                                            longestOverlap);
+                result.log += "LV " + pVertex->getID() + buffer + " BO:" + orderStr + "\n";
             }
 
             // If the link did not pass validation, cut the scaffold at this point for all involved vertices
-            if(!result)
+            if(!passed)
             {
                 for(size_t i = 0; i < edgeVec.size(); ++i)
                 {
-                    edgeVec[i]->setColor(GC_BLACK);
-                    edgeVec[i]->getEnd()->markEdgesInDir(edgeVec[i]->getTwin()->getDir(), GC_BLACK);
+                    result.markedEdges.push_back(edgeVec[i]);
+                    ScaffoldEdgePtrVector endEdges = edgeVec[i]->getEnd()->getEdges(edgeVec[i]->getTwin()->getDir());
+                    result.markedEdges.insert(result.markedEdges.end(), endEdges.begin(), endEdges.end());
                 }
-                m_numCut += 1;
+                result.count += 1;
             }
         }
     }
+}
+
+//
+bool ScaffoldLinkValidator::apply(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* /*pVertex*/, const Result& result)
+{
+    for(size_t i = 0; i < result.markedEdges.size(); ++i)
+        result.markedEdges[i]->setColor(GC_BLACK);
+    m_numCut += result.count;
+    if(!result.log.empty())
+        fputs(result.log.c_str(), stdout);
     return false;   
 }
 
@@ -342,13 +361,20 @@ void ScaffoldTransitiveReductionVisitor::previsit(ScaffoldGraph* pGraph)
 }
 
 //
-bool ScaffoldTransitiveReductionVisitor::visit(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex)
+bool ScaffoldTransitiveReductionVisitor::visit(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex)
+{
+    Result result;
+    compute(pGraph, pVertex, result);
+    return apply(pGraph, pVertex, result);
+}
+
+//
+void ScaffoldTransitiveReductionVisitor::compute(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex, Result& result) const
 {
     // Never try to make chains from a repeat
     if(pVertex->getClassification() == SVC_REPEAT)
-        return false;
+        return;
 
-    bool changed_graph = false;
     for(size_t idx = 0; idx < ED_COUNT; idx++)
     {
         EdgeDir dir = EDGE_DIRECTIONS[idx];
@@ -427,13 +453,19 @@ bool ScaffoldTransitiveReductionVisitor::visit(ScaffoldGraph* /*pGraph*/, Scaffo
         {
             if(i != lowestIdxInVec)
             {
-                edgeVec[i]->setColor(GC_BLACK);
-                edgeVec[i]->getTwin()->setColor(GC_BLACK);
-                changed_graph = true;
+                result.markedEdges.push_back(edgeVec[i]);
+                result.markedEdges.push_back(edgeVec[i]->getTwin());
             }
         }
     }
-    return changed_graph;
+}
+
+//
+bool ScaffoldTransitiveReductionVisitor::apply(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* /*pVertex*/, const Result& result)
+{
+    for(size_t i = 0; i < result.markedEdges.size(); ++i)
+        result.markedEdges[i]->setColor(GC_BLACK);
+    return !result.markedEdges.empty();
 }
 
 //
@@ -520,13 +552,20 @@ void ScaffoldSVVisitor::previsit(ScaffoldGraph* pGraph)
 }
 
 //
-bool ScaffoldSVVisitor::visit(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex)
+bool ScaffoldSVVisitor::visit(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex)
+{
+    Result result;
+    compute(pGraph, pVertex, result);
+    return apply(pGraph, pVertex, result);
+}
+
+//
+void ScaffoldSVVisitor::compute(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex, Result& result) const
 {
     // Never try to make chains from a repeat
     if(pVertex->getClassification() == SVC_REPEAT)
-        return false;
+        return;
 
-    bool changed_graph = false;
     for(size_t idx = 0; idx < ED_COUNT; idx++)
     {
         EdgeDir dir = EDGE_DIRECTIONS[idx];
@@ -593,13 +632,21 @@ bool ScaffoldSVVisitor::visit(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* pVertex
         {
             if(i != closestIdx)
             {
-                edgeVec[i]->setColor(GC_BLACK);
-                edgeVec[i]->getTwin()->setColor(GC_BLACK);
-                m_numMarked += 1;
+                result.markedEdges.push_back(edgeVec[i]);
+                result.markedEdges.push_back(edgeVec[i]->getTwin());
+                result.count += 1;
             }
         }
     }
-    return changed_graph;
+}
+
+//
+bool ScaffoldSVVisitor::apply(ScaffoldGraph* /*pGraph*/, ScaffoldVertex* /*pVertex*/, const Result& result)
+{
+    for(size_t i = 0; i < result.markedEdges.size(); ++i)
+        result.markedEdges[i]->setColor(GC_BLACK);
+    m_numMarked += result.count;
+    return false;
 }
 
 //
@@ -23,6 +23,19 @@ namespace ScaffoldAlgorithms
 
 };
 
+// The changes a visitor makes to a single vertex. Visitors that
+// can be run with ScaffoldGraph::visitParallel find the edges
+// to mark in compute() without modifying the graph, then color
+// them and write the log in apply().
+struct ScaffoldEdgeMarkResult
+{
+    ScaffoldEdgeMarkResult() : count(0) {}
+
+    ScaffoldEdgePtrVector markedEdges;
+    size_t count;
+    std::string log;
+};
+
 // Write summary statistics of the scaffold graph to stdout
 class ScaffoldStatsVisitor
 {
@@ -65,9 +78,13 @@ class ScaffoldLinkValidator
 {
     public:
         
+        typedef ScaffoldEdgeMarkResult Result;
+
         ScaffoldLinkValidator(int maxOverlap, double threshold, int verbose);
         void previsit(ScaffoldGraph* /*pGraph*/);
         bool visit(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex);
+        void compute(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex, Result& result) const;
+        bool apply(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex, const Result& result);
         void postvisit(ScaffoldGraph* /*pGraph*/);
 
     private:
@@ -98,10 +115,14 @@ class ScaffoldChainVisitor
 class ScaffoldTransitiveReductionVisitor
 {
     public:
+        typedef ScaffoldEdgeMarkResult Result;
+
         ScaffoldTransitiveReductionVisitor();
 
         void previsit(ScaffoldGraph* /*pGraph*/);
         bool visit(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex);
+        void compute(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex, Result& result) const;
+        bool apply(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex, const Result& result);
         void postvisit(ScaffoldGraph* /*pGraph*/);
 
 };
@@ -125,10 +146,14 @@ class ScaffoldPolymorphismVisitor
 class ScaffoldSVVisitor
 {
     public:
+        typedef ScaffoldEdgeMarkResult Result;
+
         ScaffoldSVVisitor(int maxSize);
         
         void previsit(ScaffoldGraph* /*pGraph*/);
         bool visit(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex);
+        void compute(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex, Result& result) const;
+        bool apply(ScaffoldGraph* pGraph, ScaffoldVertex* pVertex, const Result& result);
         void postvisit(ScaffoldGraph* /*pGraph*/);
 
     private:
@@ -149,7 +174,10 @@ class ScaffoldConflictingVisitor
         int m_numMarked;
 };
 
-// Compute a layout of the contigs linked to each vertex
+// Compute a layout of the contigs linked to each vertex.
+// This visitor classifies the vertices along the layout as repeats
+// while it runs and skips repeat vertices, so the result depends on
+// the visit order and it cannot be run with visitParallel.
 class ScaffoldLayoutVisitor
 {
     public:
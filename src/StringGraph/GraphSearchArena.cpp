@@ -0,0 +1,98 @@
+//-----------------------------------------------
+// Copyright 2010 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// GraphSearchArena - Allocation policies for the
+// nodes of a GraphSearchTree
+//
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <iostream>
+#include "GraphSearchArena.h"
+
+// The per-thread arenas are stored in thread specific data
+// so they are deleted when the thread exits
+static pthread_key_t s_arenaKey;
+static pthread_once_t s_arenaKeyOnce = PTHREAD_ONCE_INIT;
+
+static void deleteThreadArena(void* ptr)
+{
+    delete (GraphSearchArena*)ptr;
+}
+
+static void createArenaKey()
+{
+    int ret = pthread_key_create(&s_arenaKey, deleteThreadArena);
+    if(ret != 0)
+    {
+        std::cerr << "Failed to create the search arena key with error " << ret << ", aborting" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+GraphSearchArena::GraphSearchArena() : m_currBlock(0), m_offset(0)
+{
+
+}
+
+//
+GraphSearchArena::~GraphSearchArena()
+{
+    for(size_t i = 0; i < m_blocks.size(); ++i)
+        delete [] m_blocks[i];
+}
+
+//
+void* GraphSearchArena::allocate(size_t size)
+{
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    assert(size <= BLOCK_SIZE);
+
+    // Move to the next block if the allocation does not fit in the current one
+    if(m_currBlock < m_blocks.size() && m_offset + size > BLOCK_SIZE)
+    {
+        m_currBlock += 1;
+        m_offset = 0;
+    }
+
+    if(m_currBlock == m_blocks.size())
+        m_blocks.push_back(new char[BLOCK_SIZE]);
+
+    void* ptr = m_blocks[m_currBlock] + m_offset;
+    m_offset += size;
+    return ptr;
+}
+
+//
+GraphSearchArena::Mark GraphSearchArena::getMark() const
+{
+    Mark mark;
+    mark.block = m_currBlock;
+    mark.offset = m_offset;
+    return mark;
+}
+
+//
+void GraphSearchArena::release(const Mark& mark)
+{
+    assert(mark.block < m_currBlock || (mark.block == m_currBlock && mark.offset <= m_offset));
+    m_currBlock = mark.block;
+    m_offset = mark.offset;
+}
+
+//
+GraphSearchArena* GraphSearchArena::getThreadArena()
+{
+    pthread_once(&s_arenaKeyOnce, createArenaKey);
+    GraphSearchArena* pArena = (GraphSearchArena*)pthread_getspecific(s_arenaKey);
+    if(pArena == NULL)
+    {
+        pArena = new GraphSearchArena;
+        pthread_setspecific(s_arenaKey, pArena);
+    }
+    return pArena;
+}
@@ -0,0 +1,99 @@
+//-----------------------------------------------
+// Copyright 2010 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// GraphSearchArena - Allocation policies for the
+// nodes of a GraphSearchTree. The heap policy 
+// allocates and frees every node individually. The
+// arena policy takes nodes from a per-thread bump 
+// allocator and releases all the nodes of a search 
+// at once when the tree is destroyed.
+//
+#ifndef GRAPHSEARCHARENA_H
+#define GRAPHSEARCHARENA_H
+
+#include <vector>
+#include <stddef.h>
+
+// A bump allocator made up of large blocks of memory. 
+// Releasing memory only resets the position in the blocks,
+// the blocks are kept to be reused by the next search.
+class GraphSearchArena
+{
+    public:
+
+        // A position in the arena that memory can be released back to
+        struct Mark
+        {
+            size_t block;
+            size_t offset;
+        };
+
+        GraphSearchArena();
+        ~GraphSearchArena();
+
+        // Allocate size bytes
+        void* allocate(size_t size);
+
+        // Release all the memory allocated after mark was taken
+        // Marks must be released in the reverse order they were taken
+        Mark getMark() const;
+        void release(const Mark& mark);
+
+        // Returns the number of bytes held by the arena
+        size_t getCapacity() const { return m_blocks.size() * BLOCK_SIZE; }
+
+        // Returns the arena owned by the calling thread
+        static GraphSearchArena* getThreadArena();
+
+    private:
+        
+        static const size_t BLOCK_SIZE = 1 << 16;
+        static const size_t ALIGNMENT = 16;
+
+        std::vector<char*> m_blocks;
+        size_t m_currBlock;
+        size_t m_offset;
+};
+
+// Allocate each node with operator new and free 
+// them one by one when the tree is destroyed
+class GraphSearchHeapAllocator
+{
+    public:
+        // The tree must free each node it allocated
+        static const bool RELEASES_ALL = false;
+
+        void* allocate(size_t size) { return ::operator new(size); }
+        void deallocate(void* ptr) { ::operator delete(ptr); }
+};
+
+// Allocate the nodes from the arena of the calling thread. All the 
+// nodes are released in constant time when the allocator is 
+// destroyed so the tree does not need to walk the nodes. The trees
+// of a thread must be destroyed in the reverse order they were created,
+// which is always the case for trees on the stack.
+class GraphSearchArenaAllocator
+{
+    public:
+        // Destroying the allocator frees every node
+        static const bool RELEASES_ALL = true;
+
+        GraphSearchArenaAllocator() : m_pArena(GraphSearchArena::getThreadArena()), 
+                                      m_mark(m_pArena->getMark()) {}
+        ~GraphSearchArenaAllocator() { m_pArena->release(m_mark); }
+
+        void* allocate(size_t size) { return m_pArena->allocate(size); }
+        void deallocate(void*) {}
+
+    private:
+        GraphSearchArenaAllocator(const GraphSearchArenaAllocator&);
+        GraphSearchArenaAllocator& operator=(const GraphSearchArenaAllocator&);
+
+        GraphSearchArena* m_pArena;
+        GraphSearchArena::Mark m_mark;
+};
+
+#endif
@@ -8,15 +8,20 @@
 // a breadth-first search of a bidirectional graph. It is designed
 // to return all possible walks between the given start
 // and end vertices, up to a given distance. Used to search a
-// string graph or scaffold graph.
+// string graph or scaffold graph. The nodes of the
+// tree are allocated using the ALLOCATOR policy, see
+// GraphSearchArena.h.
 //
 #ifndef GRAPHSEARCHTREE_H
 #define GRAPHSEARCHTREE_H
 
 #include "Bigraph.h"
 #include "SGWalk.h"
+#include "GraphSearchArena.h"
 #include <deque>
 #include <queue>
+#include <map>
+#include <new>
 
 template<typename VERTEX, typename EDGE, typename DISTANCE>
 class GraphSearchNode
@@ -35,7 +40,8 @@ class GraphSearchNode
 
         // Create the children of this node and place pointers to their nodes
         // on the queue. Returns the number of children created;
-        int createChildren(GraphSearchNodePtrDeque& outQueue, const DISTANCE& distanceFunc);
+        template<typename ALLOCATOR>
+        int createChildren(GraphSearchNodePtrDeque& outQueue, const DISTANCE& distanceFunc, ALLOCATOR& allocator);
 
         GraphSearchNode* getParent() const { return m_pParent; }
         VERTEX* getVertex() const { return m_pVertex; }
@@ -55,7 +61,7 @@ class GraphSearchNode
         int64_t m_distance;
 };
 
-template<typename VERTEX, typename EDGE, typename DISTANCE>
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR = GraphSearchHeapAllocator>
 class GraphSearchTree
 {
     // typedefs
@@ -86,9 +92,9 @@ class GraphSearchTree
         // other words, all walks from the start node share a common vertex,
         // which is represented by one of the nodes waiting expansion.
         // This function is the key to finding collapsed walks that represent
-        // complex variation bubbles. It is a heavy operation however, as the
-        // entire tree is search for each node in the expand queue. It should
-        // only be used on small trees.
+        // complex variation bubbles. Each branch of the tree is walked at most
+        // once per call, but this is still proportional to the size of the 
+        // tree so it should only be used on small trees.
         // Returns true if the search converged and the pointer to the vertex
         // is return in pConvergedVertex.
         bool hasSearchConverged(VERTEX*& pConvergedVertex);
@@ -153,6 +159,9 @@ class GraphSearchTree
 
         // Distance functor
         DISTANCE m_distanceFunc;
+
+        // Allocator for the search nodes
+        ALLOCATOR m_allocator;
 };
 
 //
@@ -203,7 +212,10 @@ void GraphSearchNode<VERTEX,EDGE,DISTANCE>::decrementChildren()
 // and place pointers to them in the queue.
 // Returns the number of nodes created
 template<typename VERTEX, typename EDGE, typename DISTANCE>
-int GraphSearchNode<VERTEX,EDGE,DISTANCE>::createChildren(GraphSearchNodePtrDeque& outDeque, const DISTANCE& distanceFunc)
+template<typename ALLOCATOR>
+int GraphSearchNode<VERTEX,EDGE,DISTANCE>::createChildren(GraphSearchNodePtrDeque& outDeque, 
+                                                          const DISTANCE& distanceFunc, 
+                                                          ALLOCATOR& allocator)
 {
     assert(m_numChildren == 0);
 
@@ -212,7 +224,8 @@ int GraphSearchNode<VERTEX,EDGE,DISTANCE>::createChildren(GraphSearchNodePtrDequ
     for(size_t i = 0; i < edges.size(); ++i)
     {
         EdgeDir childExpandDir = !edges[i]->getTwin()->getDir();
-        GraphSearchNode* pNode = new GraphSearchNode(edges[i]->getEnd(), childExpandDir, this, edges[i], distanceFunc(edges[i]));
+        void* pMemory = allocator.allocate(sizeof(GraphSearchNode));
+        GraphSearchNode* pNode = new (pMemory) GraphSearchNode(edges[i]->getEnd(), childExpandDir, this, edges[i], distanceFunc(edges[i]));
         outDeque.push_back(pNode);
         m_numChildren += 1;
     }
@@ -222,8 +235,8 @@ int GraphSearchNode<VERTEX,EDGE,DISTANCE>::createChildren(GraphSearchNodePtrDequ
 //
 // GraphSearchTree
 //
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-GraphSearchTree<VERTEX,EDGE,DISTANCE>::GraphSearchTree(VERTEX* pStartVertex, 
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::GraphSearchTree(VERTEX* pStartVertex, 
                                                        VERTEX* pEndVertex, 
                                                        EdgeDir searchDir,
                                                        int64_t distanceLimit,
@@ -233,7 +246,8 @@ GraphSearchTree<VERTEX,EDGE,DISTANCE>::GraphSearchTree(VERTEX* pStartVertex,
                                                                            m_searchAborted(false)
 {
     // Create the root node of the search tree
-    m_pRootNode = new GraphSearchNode<VERTEX, EDGE, DISTANCE>(pStartVertex, searchDir, NULL, NULL, 0);
+    void* pMemory = m_allocator.allocate(sizeof(_SearchNode));
+    m_pRootNode = new (pMemory) _SearchNode(pStartVertex, searchDir, NULL, NULL, 0);
 
     // add the root to the expand queue
     m_expandQueue.push_back(m_pRootNode);
@@ -241,9 +255,13 @@ GraphSearchTree<VERTEX,EDGE,DISTANCE>::GraphSearchTree(VERTEX* pStartVertex,
     m_totalNodes = 1;
 }
 
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-GraphSearchTree<VERTEX,EDGE,DISTANCE>::~GraphSearchTree()
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::~GraphSearchTree()
 {
+    // If the allocator frees all the nodes at once there is nothing to do
+    if(ALLOCATOR::RELEASES_ALL)
+        return;
+
     // Delete the tree
     // We delete each leaf and recurse up the tree iteratively deleting
     // parents with a single child node. This ensure that each parent is
@@ -266,7 +284,8 @@ GraphSearchTree<VERTEX,EDGE,DISTANCE>::~GraphSearchTree()
             assert(pCurr->getNumChildren() == 0);
             _SearchNode* pNext = pCurr->getParent();
             
-            delete pCurr; // decrements pNext's child count
+            pCurr->~_SearchNode(); // decrements pNext's child count
+            m_allocator.deallocate(pCurr);
             totalDeleted += 1;
 
             pCurr = pNext;
@@ -277,8 +296,8 @@ GraphSearchTree<VERTEX,EDGE,DISTANCE>::~GraphSearchTree()
 }
 
 // Perform one step of the BFS
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-bool GraphSearchTree<VERTEX,EDGE,DISTANCE>::stepOnce()
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+bool GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::stepOnce()
 {
     if(m_expandQueue.empty())
         return false;
@@ -319,7 +338,7 @@ bool GraphSearchTree<VERTEX,EDGE,DISTANCE>::stepOnce()
         else
         {
             // Add the children of this node to the queue
-            int numCreated = pNode->createChildren(incomingQueue, m_distanceFunc);
+            int numCreated = pNode->createChildren(incomingQueue, m_distanceFunc, m_allocator);
             m_totalNodes += numCreated;
 
             if(numCreated == 0)
@@ -337,56 +356,78 @@ bool GraphSearchTree<VERTEX,EDGE,DISTANCE>::stepOnce()
 // Return true if all the walks from the root converge
 // to one vertex (ie if the search from pX converged
 // to pY, then ALL paths from pX must go through pY).
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-bool GraphSearchTree<VERTEX,EDGE,DISTANCE>::hasSearchConverged(VERTEX*& pConvergedVertex)
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+bool GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::hasSearchConverged(VERTEX*& pConvergedVertex)
 {
-    // Construct a set of all the leaf nodes
-    _SearchNodePtrDeque completeLeafNodes;
-    _makeFullLeafQueue(completeLeafNodes);
+    pConvergedVertex = NULL;
 
-    // Search all the tree for all the nodes in the expand queue
+    // The candidates are the vertices of the nodes in the expand queue.
+    // If this node has the same vertex as the root skip it
+    // We do not want to collapse at the root
+    typedef std::map<VERTEX*, size_t> CountMap;
+    CountMap branchCounts;
     for(typename _SearchNodePtrDeque::iterator iter = m_expandQueue.begin(); 
                                                iter != m_expandQueue.end();
                                                ++iter)
     {
-        _SearchNode* pNode = *iter;
-        // If this node has the same vertex as the root skip it
-        // We do not want to collapse at the root
-        if(pNode->getVertex() == m_pRootNode->getVertex())
-            continue;
+        if((*iter)->getVertex() != m_pRootNode->getVertex())
+            branchCounts[(*iter)->getVertex()] = 0;
+    }
+
+    if(branchCounts.empty())
+        return false;
+
+    // Construct a set of all the leaf nodes
+    _SearchNodePtrDeque completeLeafNodes;
+    _makeFullLeafQueue(completeLeafNodes);
 
-        bool isInAllBranches = true;
-        for(typename _SearchNodePtrDeque::iterator leafIter = completeLeafNodes.begin();
-                                                   leafIter != completeLeafNodes.end();
-                                                   ++leafIter)
+    // Walk each branch to the root once, counting the number of branches
+    // each candidate is found in. A candidate is only counted once per branch
+    // and only if it has been found in all the previous branches, so the
+    // search stops as soon as no candidate can be in every branch.
+    size_t numBranches = 0;
+    for(typename _SearchNodePtrDeque::iterator leafIter = completeLeafNodes.begin();
+                                               leafIter != completeLeafNodes.end();
+                                               ++leafIter)
+    {
+        size_t numInAllBranches = 0;
+        for(_SearchNode* pNode = *leafIter; pNode != NULL && pNode != m_pRootNode; pNode = pNode->getParent())
         {
-            // Search the current branch from this leaf node to the root
-            _SearchNode* pFoundNode = NULL;
-            bool isInBranch = searchBranchForVertex(*leafIter, pNode->getVertex(), pFoundNode);
-            if(!isInBranch)
+            typename CountMap::iterator countIter = branchCounts.find(pNode->getVertex());
+            if(countIter != branchCounts.end() && countIter->second == numBranches)
             {
-                isInAllBranches = false;
-                break;
+                countIter->second += 1;
+                numInAllBranches += 1;
             }
         }
-    
-        // search has converted
-        if(isInAllBranches)
+
+        numBranches += 1;
+        if(numInAllBranches == 0)
+            return false; // search has not converged
+    }
+
+    // Return the first node in the expand queue that is in every branch
+    for(typename _SearchNodePtrDeque::iterator iter = m_expandQueue.begin(); 
+                                               iter != m_expandQueue.end();
+                                               ++iter)
+    {
+        typename CountMap::iterator countIter = branchCounts.find((*iter)->getVertex());
+        if(countIter != branchCounts.end() && countIter->second == numBranches)
         {
-            pConvergedVertex = pNode->getVertex();
+            // search has converged
+            pConvergedVertex = (*iter)->getVertex();
             return true;
         }
     }
 
-    // search has not converted
-    pConvergedVertex = NULL;
+    // search has not converged
     return false;
 }
 
 // Construct walks representing every path from the start node
-template<typename VERTEX, typename EDGE, typename DISTANCE>
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
 template<typename BUILDER>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::buildWalksToAllLeaves(BUILDER& walkBuilder)
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::buildWalksToAllLeaves(BUILDER& walkBuilder)
 {
     // Construct a queue with all leaf nodes in it
     _SearchNodePtrDeque completeLeafNodes;
@@ -396,17 +437,17 @@ void GraphSearchTree<VERTEX,EDGE,DISTANCE>::buildWalksToAllLeaves(BUILDER& walkB
 }
 
 // Construct walks representing every path from the start vertex to the goal vertex
-template<typename VERTEX, typename EDGE, typename DISTANCE>
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
 template<typename BUILDER>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::buildWalksToGoal(BUILDER& walkBuilder)
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::buildWalksToGoal(BUILDER& walkBuilder)
 {
     _buildWalksToLeaves(m_goalQueue, walkBuilder);
 }
 
 // Build all the walks that contain pTarget.
-template<typename VERTEX, typename EDGE, typename DISTANCE>
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
 template<typename BUILDER>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::buildWalksContainingVertex(VERTEX* pTarget, BUILDER& walkBuilder)
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::buildWalksContainingVertex(VERTEX* pTarget, BUILDER& walkBuilder)
 {
     _SearchNodePtrDeque completeLeafNodes;
     _makeFullLeafQueue(completeLeafNodes);
@@ -434,9 +475,9 @@ void GraphSearchTree<VERTEX,EDGE,DISTANCE>::buildWalksContainingVertex(VERTEX* p
 }
 
 // Main function for constructing a vector of walks from a set of leaves
-template<typename VERTEX, typename EDGE, typename DISTANCE>
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
 template<typename BUILDER>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::_buildWalksToLeaves(const _SearchNodePtrDeque& queue, BUILDER& walkBuilder)
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::_buildWalksToLeaves(const _SearchNodePtrDeque& queue, BUILDER& walkBuilder)
 {
     for(typename _SearchNodePtrDeque::const_iterator iter = queue.begin();
                                                      iter != queue.end();
@@ -458,8 +499,8 @@ void GraphSearchTree<VERTEX,EDGE,DISTANCE>::_buildWalksToLeaves(const _SearchNod
 // Return true if the vertex pX is found somewhere in the branch 
 // from pNode to the root. If it is found, pFoundNode is set
 // to the furtherest instance of pX from the root.
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-bool GraphSearchTree<VERTEX,EDGE,DISTANCE>::searchBranchForVertex(_SearchNode* pNode, VERTEX* pX, _SearchNode*& pFoundNode) const
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+bool GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::searchBranchForVertex(_SearchNode* pNode, VERTEX* pX, _SearchNode*& pFoundNode) const
 {
     if(pNode == NULL)
     {
@@ -476,8 +517,8 @@ bool GraphSearchTree<VERTEX,EDGE,DISTANCE>::searchBranchForVertex(_SearchNode* p
 }
 
 //
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::addEdgesFromBranch(_SearchNode* pNode, WALK& outEdges)
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::addEdgesFromBranch(_SearchNode* pNode, WALK& outEdges)
 {
     // Terminate the recursion at the root node and dont add an edge
     if(pNode->getParent() != NULL)
@@ -488,8 +529,8 @@ void GraphSearchTree<VERTEX,EDGE,DISTANCE>::addEdgesFromBranch(_SearchNode* pNod
 }
 
 //
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::_makeFullLeafQueue(_SearchNodePtrDeque& completeQueue) const
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::_makeFullLeafQueue(_SearchNodePtrDeque& completeQueue) const
 {
     completeQueue.insert(completeQueue.end(), m_expandQueue.begin(), m_expandQueue.end());
     completeQueue.insert(completeQueue.end(), m_goalQueue.begin(), m_goalQueue.end());
@@ -497,8 +538,8 @@ void GraphSearchTree<VERTEX,EDGE,DISTANCE>::_makeFullLeafQueue(_SearchNodePtrDeq
 }
 
 //
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::printBranch(_SearchNode* pNode) const
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::printBranch(_SearchNode* pNode) const
 {
     if(pNode != NULL)
     {
@@ -507,8 +548,8 @@ void GraphSearchTree<VERTEX,EDGE,DISTANCE>::printBranch(_SearchNode* pNode) cons
     }
 }
 
-template<typename VERTEX, typename EDGE, typename DISTANCE>
-void GraphSearchTree<VERTEX,EDGE,DISTANCE>::connectedComponents(VertexPtrVector allVertices, 
+template<typename VERTEX, typename EDGE, typename DISTANCE, typename ALLOCATOR>
+void GraphSearchTree<VERTEX,EDGE,DISTANCE,ALLOCATOR>::connectedComponents(VertexPtrVector allVertices, 
                                                                 VertexPtrVectorVector& connectedComponents)
 {
     // Set the color of each vertex to be white signalling its not visited
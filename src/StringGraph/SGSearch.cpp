@@ -9,6 +9,86 @@
 //
 #include "SGSearch.h"
 #include <queue>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+// The number of searches that hit their node budget, shared by all threads
+static size_t s_numAbortedSearches = 0;
+
+// A node in one half of a bidirectional search. For the forward half,
+// pEdge is the edge from the parent and dir is the direction the node
+// will be expanded in. For the backward half, pEdge is the edge leaving
+// the vertex towards the parent (which is closer to the goal) and dir is
+// the direction of that edge.
+struct SGBidirectionalNode
+{
+    SGBidirectionalNode(Vertex* pV, EdgeDir d, int64_t dist, int p, Edge* pE, size_t idx) : pVertex(pV), 
+                                                                                          dir(d),
+                                                                                          distance(dist),
+                                                                                          parent(p),
+                                                                                          pEdge(pE),
+                                                                                          edgeIdx(idx) {}
+    Vertex* pVertex;
+    EdgeDir dir;
+    int64_t distance;
+    int parent;
+    Edge* pEdge;
+
+    // The index of pEdge in the edges of its start vertex
+    size_t edgeIdx;
+};
+typedef std::vector<SGBidirectionalNode> SGBidirectionalNodeVector;
+
+// A walk built by joining the halves of the search. The walks are
+// sorted by the edge indices along the walk, which is the order
+// the breadth-first search tree would have found them in.
+struct SGBidirectionalWalk
+{
+    EdgePtrVec edges;
+    std::vector<size_t> order;
+
+    bool operator<(const SGBidirectionalWalk& other) const
+    {
+        if(order.size() != other.order.size())
+            return order.size() < other.order.size();
+        return order < other.order;
+    }
+};
+typedef std::vector<SGBidirectionalWalk> SGBidirectionalWalkVector;
+
+// Returns the index of pEdge in the edges of its start vertex in the direction of the edge
+static size_t getEdgeIndex(Edge* pEdge)
+{
+    EdgePtrVec edges = pEdge->getStart()->getEdges(pEdge->getDir());
+    EdgePtrVec::iterator iter = std::find(edges.begin(), edges.end(), pEdge);
+    assert(iter != edges.end());
+    return iter - edges.begin();
+}
+
+// Append the edges from the root of the forward half to node idx
+static void addForwardEdges(const SGBidirectionalNodeVector& nodes, int idx, SGBidirectionalWalk& walk)
+{
+    size_t first = walk.edges.size();
+    for(; nodes[idx].parent != -1; idx = nodes[idx].parent)
+    {
+        walk.edges.push_back(nodes[idx].pEdge);
+        walk.order.push_back(nodes[idx].edgeIdx);
+    }
+    std::reverse(walk.edges.begin() + first, walk.edges.end());
+    std::reverse(walk.order.begin() + first, walk.order.end());
+}
+
+// Append the edges from node idx of the backward half to the goal
+static void addBackwardEdges(const SGBidirectionalNodeVector& nodes, int idx, SGBidirectionalWalk& walk)
+{
+    for(; idx != -1; idx = nodes[idx].parent)
+    {
+        walk.edges.push_back(nodes[idx].pEdge);
+        walk.order.push_back(nodes[idx].edgeIdx);
+    }
+}
 
 //
 SGWalkBuilder::SGWalkBuilder(SGWalkVector& outWalks, bool bIndexWalk) : m_outWalks(outWalks), m_pCurrWalk(NULL), m_bIndexWalk(bIndexWalk)
@@ -58,6 +138,9 @@ bool SGSearch::findWalks(Vertex* pX, Vertex* pY, EdgeDir initialDir,
     // Iteravively perform the BFS using the search tree.
     while(searchTree.stepOnce()) { }
 
+    if(searchTree.wasSearchAborted())
+        __sync_fetch_and_add(&s_numAbortedSearches, 1);
+
     // If the search was aborted, do not return any walks
     // because we do not know if there are more valid paths from pX
     // to pY that we could not find because the search space was too large
@@ -70,6 +153,170 @@ bool SGSearch::findWalks(Vertex* pX, Vertex* pY, EdgeDir initialDir,
     return !searchTree.wasSearchAborted();
 }
 
+// Every walk found by findWalks is split at its first node that is further than
+// some split distance from pX. The prefix up to and including that node is found by
+// expanding from pX, as in findWalks. The suffix from that node to pY is found by
+// walking backwards from pY along the twin edges. Both halves are grown in order of
+// distance, extending the half with the smaller frontier, until the prefixes and
+// the suffixes (not counting their last edge) together cover maxDistance. The nodes
+// left in the forward queue are past the split point and are joined to the suffixes
+// that start at the same vertex, leave it in the same direction and keep the walk
+// within maxDistance. Neither half can pass through pY.
+bool SGSearch::findWalksBidirectional(Vertex* pX, Vertex* pY, EdgeDir initialDir,
+                                      int maxDistance, size_t maxNodes, bool exhaustive, SGWalkVector& outWalks)
+{
+    // The start vertex is the goal, there is nothing to join
+    if(pX == pY)
+        return findWalks(pX, pY, initialDir, maxDistance, maxNodes, exhaustive, outWalks);
+
+    typedef std::pair<int64_t, int> QueueEntry;
+    typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > NodeQueue;
+    typedef std::map<std::pair<Vertex*, EdgeDir>, std::vector<int> > SuffixMap;
+
+    SGDistanceFunction distanceFunc;
+    const int64_t noDistance = std::numeric_limits<int64_t>::max() / 4;
+    bool aborted = false;
+    SGBidirectionalWalkVector walks;
+
+    SGBidirectionalNodeVector forward;
+    NodeQueue forwardQueue;
+    forward.push_back(SGBidirectionalNode(pX, initialDir, 0, -1, NULL, 0));
+    forwardQueue.push(QueueEntry(0, 0));
+
+    // The suffixes are indexed by the vertex they start at
+    // and the direction they leave it in
+    SGBidirectionalNodeVector backward;
+    NodeQueue backwardQueue;
+    SuffixMap suffixMap;
+    for(size_t i = 0; i < ED_COUNT; ++i)
+    {
+        EdgePtrVec edges = pY->getEdges(EDGE_DIRECTIONS[i]);
+        for(size_t j = 0; j < edges.size(); ++j)
+        {
+            Edge* pEdge = edges[j]->getTwin();
+            if(pEdge->getStart() == pY)
+                continue;
+            backwardQueue.push(QueueEntry(0, backward.size()));
+            backward.push_back(SGBidirectionalNode(pEdge->getStart(), pEdge->getDir(), 0, -1, pEdge, getEdgeIndex(pEdge)));
+        }
+    }
+
+    while(!aborted)
+    {
+        int64_t forwardNext = forwardQueue.empty() ? noDistance : forwardQueue.top().first;
+        int64_t backwardNext = backwardQueue.empty() ? noDistance : backwardQueue.top().first;
+        if(forwardNext + backwardNext > maxDistance)
+            break;
+
+        if(backwardQueue.empty() || (!forwardQueue.empty() && forwardQueue.size() <= backwardQueue.size()))
+        {
+            // Expand all the forward nodes at the next distance
+            while(!forwardQueue.empty() && forwardQueue.top().first == forwardNext && !aborted)
+            {
+                int idx = forwardQueue.top().second;
+                forwardQueue.pop();
+                SGBidirectionalNode node = forward[idx];
+
+                if(node.pVertex == pY)
+                {
+                    walks.push_back(SGBidirectionalWalk());
+                    addForwardEdges(forward, idx, walks.back());
+                    continue;
+                }
+
+                EdgePtrVec edges = node.pVertex->getEdges(node.dir);
+                for(size_t j = 0; j < edges.size(); ++j)
+                {
+                    EdgeDir childExpandDir = !edges[j]->getTwin()->getDir();
+                    int64_t distance = node.distance + distanceFunc(edges[j]);
+                    forwardQueue.push(QueueEntry(distance, forward.size()));
+                    forward.push_back(SGBidirectionalNode(edges[j]->getEnd(), childExpandDir, distance, idx, edges[j], j));
+                }
+                aborted = forward.size() + backward.size() > maxNodes;
+            }
+        }
+        else
+        {
+            // Add all the suffixes at the next distance to the index and extend them.
+            // The walk must arrive at the start of a suffix by an edge whose twin
+            // points in the opposite direction of the edge leaving it
+            while(!backwardQueue.empty() && backwardQueue.top().first == backwardNext && !aborted)
+            {
+                int idx = backwardQueue.top().second;
+                backwardQueue.pop();
+                SGBidirectionalNode node = backward[idx];
+                suffixMap[std::make_pair(node.pVertex, node.dir)].push_back(idx);
+
+                EdgePtrVec edges = node.pVertex->getEdges(!node.dir);
+                for(size_t j = 0; j < edges.size(); ++j)
+                {
+                    Edge* pEdge = edges[j]->getTwin();
+                    if(pEdge->getStart() == pY)
+                        continue;
+                    int64_t distance = node.distance + distanceFunc(pEdge);
+                    backwardQueue.push(QueueEntry(distance, backward.size()));
+                    backward.push_back(SGBidirectionalNode(pEdge->getStart(), pEdge->getDir(), distance, idx, pEdge, getEdgeIndex(pEdge)));
+                }
+                aborted = forward.size() + backward.size() > maxNodes;
+            }
+        }
+    }
+
+    // Join the prefixes to the suffixes
+    while(!forwardQueue.empty() && !aborted)
+    {
+        int idx = forwardQueue.top().second;
+        forwardQueue.pop();
+        SGBidirectionalNode node = forward[idx];
+
+        if(node.pVertex == pY)
+        {
+            walks.push_back(SGBidirectionalWalk());
+            addForwardEdges(forward, idx, walks.back());
+            continue;
+        }
+
+        SuffixMap::const_iterator iter = suffixMap.find(std::make_pair(node.pVertex, node.dir));
+        if(iter == suffixMap.end())
+            continue;
+
+        for(size_t j = 0; j < iter->second.size(); ++j)
+        {
+            int suffixIdx = iter->second[j];
+            if(node.distance + backward[suffixIdx].distance > maxDistance)
+                continue;
+
+            walks.push_back(SGBidirectionalWalk());
+            addForwardEdges(forward, idx, walks.back());
+            addBackwardEdges(backward, suffixIdx, walks.back());
+        }
+        aborted = forward.size() + backward.size() + walks.size() > maxNodes;
+    }
+
+    if(aborted)
+        __sync_fetch_and_add(&s_numAbortedSearches, 1);
+
+    if(!aborted || !exhaustive)
+    {
+        std::sort(walks.begin(), walks.end());
+        SGWalkBuilder builder(outWalks, false);
+        for(size_t i = 0; i < walks.size(); ++i)
+        {
+            builder.startNewWalk(pX);
+            for(size_t j = 0; j < walks[i].edges.size(); ++j)
+                builder.addEdge(walks[i].edges[j]);
+            builder.finishCurrentWalk();
+        }
+    }
+    return !aborted;
+}
+
+//
+size_t SGSearch::getNumAbortedSearches()
+{
+    return s_numAbortedSearches;
+}
+
 // Search the graph for a set of walks that represent alternate
 // versions of the same sequence. These walks are found by searching
 // the graph for a set of walks that start/end at a common vertex and cover
@@ -25,8 +25,8 @@ struct SGDistanceFunction
     }
 };
 
-// 
-typedef GraphSearchTree<Vertex, Edge, SGDistanceFunction> SGSearchTree;
+// The search nodes are taken from the arena of the calling thread
+typedef GraphSearchTree<Vertex, Edge, SGDistanceFunction, GraphSearchArenaAllocator> SGSearchTree;
 
 //
 struct SGWalkBuilder
@@ -61,6 +61,22 @@ namespace SGSearch
                    bool exhaustive,
                    SGWalkVector& outWalks);
 
+    // Find the same walks as findWalks by expanding half of the distance
+    // from pX and the remainder backwards from pY, joining the two halves
+    // on the vertices they share. maxNodes bounds the number of nodes explored
+    // by both halves together.
+    bool findWalksBidirectional(Vertex* pX, 
+                                Vertex* pY, 
+                                EdgeDir initialDir,
+                                int maxDistance, 
+                                size_t maxNodes, 
+                                bool exhaustive,
+                                SGWalkVector& outWalks);
+
+    // Returns the number of findWalks searches that were aborted
+    // because they exceeded their node budget
+    size_t getNumAbortedSearches();
+
     void findVariantWalks(Vertex* pX, 
                           EdgeDir initialDir, 
                           int maxDistance,
@@ -7,6 +7,7 @@
 // bwt_algorithms.cpp - Algorithms for aligning to a bwt structure
 //
 #include "BWTAlgorithms.h"
+#include <algorithm>
 
 // Find the interval in pBWT corresponding to w
 // If w does not exist in the BWT, the interval 
@@ -156,6 +157,50 @@ size_t BWTAlgorithms::countSequenceOccurrences(const std::string& w, const BWTIn
         return countSequenceOccurrences(w, indices.pBWT);
 }
 
+//
+std::vector<size_t> BWTAlgorithms::countPopulationCoverage(const std::string& w, const BWTIndexSet& indices, int64_t maxIntervalSize)
+{
+    assert(indices.pBWT != NULL);
+    assert(indices.pPopColors != NULL || (indices.pSSA != NULL && indices.pPopIdx != NULL));
+
+    std::string rc_w = reverseComplement(w);
+    std::vector<size_t> readIDs;
+    std::vector<size_t> counts;
+    for(size_t i = 0; i < 2; ++i)
+    {
+        // A palindrome has a single interval
+        if(i == 1 && rc_w == w)
+            break;
+
+        BWTInterval interval = findInterval(indices, i == 0 ? w : rc_w);
+        if(interval.size() >= maxIntervalSize)
+            continue;
+
+        if(indices.pPopColors != NULL)
+        {
+            std::vector<size_t> incoming = indices.pPopColors->countSampleOccurrences(interval);
+            counts.resize(incoming.size(), 0);
+            for(size_t j = 0; j < incoming.size(); ++j)
+                counts[j] += incoming[j];
+        }
+        else
+        {
+            indices.pSSA->calcReadIDs(interval, indices.pBWT, readIDs);
+        }
+    }
+
+    if(indices.pPopColors != NULL)
+    {
+        counts.resize(indices.pPopColors->getNumSamples(), 0);
+        return counts;
+    }
+
+    // A read containing multiple copies of w is counted once
+    std::sort(readIDs.begin(), readIDs.end());
+    readIDs.erase(std::unique(readIDs.begin(), readIDs.end()), readIDs.end());
+    return indices.pPopIdx->countSampleReads(readIDs);
+}
+
 // Return the count of all the possible one base extensions of the string w.
 // This returns the number of times the suffix w[i, l]A, w[i, l]C, etc 
 // appears in the FM-index for all i s.t. length(w[i, l]) == overlapLen.
@@ -53,6 +53,15 @@ size_t countSequenceOccurrences(const std::string& w, const BWT* pBWT);
 size_t countSequenceOccurrencesWithCache(const std::string& w, const BWT* pBWT, const BWTIntervalCache* pIntervalCache);
 size_t countSequenceOccurrences(const std::string& w, const BWTIndexSet& indices);
 
+// Count the number of reads in each sample of the population index that contain
+// w or its reverse complement. Each read is counted once. The read IDs are computed
+// from the intervals using the sampled suffix array, the reads are not extracted. 
+// If the population color index is loaded, the occurrences of w are counted
+// directly from the colors instead, so a read with more than one copy of w
+// is counted more than once.
+// Intervals with maxIntervalSize or more suffixes are skipped.
+std::vector<size_t> countPopulationCoverage(const std::string& w, const BWTIndexSet& indices, int64_t maxIntervalSize);
+
 // Update the given interval using backwards search
 // If the interval corrsponds to string S, it will be updated 
 // for string bS
@@ -16,6 +16,7 @@
 #include "SAWriter.h"
 #include "SAReader.h"
 #include "GapArray.h"
+#include "BitVector.h"
 #include "RankProcess.h"
 #include "SequenceProcessFramework.h"
 #include "BWTCABauerCoxRosone.h"
@@ -58,6 +59,7 @@ void writeMergedIndex(const BWT* pBWTInternal, const MergeItem& externalItem,
 
 void writeRemovalIndex(const BWT* pBWTInternal, const std::string& sai_inname,
                        const std::string& bwt_outname, const std::string& sai_outname, 
+                       const std::string& kept_outname,
                        size_t num_strings_remove, size_t num_symbols_remove,
                        const GapArray* pGapArray);
 
@@ -312,7 +314,8 @@ void mergeIndependentIndices(const std::string& readsFile1, const std::string& r
 // Construct new indices without the reads in readsToRemove
 void removeReadsFromIndices(const std::string& allReadsPrefix, const std::string& readsToRemove,
                              const std::string& outPrefix, const std::string& bwt_extension, 
-                             const std::string& sai_extension, bool doReverse, int numThreads)
+                             const std::string& sai_extension, bool doReverse, int numThreads,
+                             const std::string& keptFilename)
 {
     std::string bwt_filename = makeFilename(allReadsPrefix, bwt_extension);
     std::string sai_filename = makeFilename(allReadsPrefix, sai_extension);
@@ -335,7 +338,7 @@ void removeReadsFromIndices(const std::string& allReadsPrefix, const std::string
     computeGapArray(pReader, (size_t)-1, pBWT, doReverse, numThreads, pGapArray, true, num_strings_remove, num_symbols_remove);
 
     //writeRemovalIndex();
-    writeRemovalIndex(pBWT, sai_filename, bwt_out_name, sai_out_name, num_strings_remove, num_symbols_remove, pGapArray);
+    writeRemovalIndex(pBWT, sai_filename, bwt_out_name, sai_out_name, keptFilename, num_strings_remove, num_symbols_remove, pGapArray);
 
     // Perform the actual merge
     //merge(pReader, item1, item2, bwt_merged_name, sai_merged_name, doReverse, numThreads);
@@ -575,6 +578,7 @@ void writeMergedIndex(const BWT* pBWTInternal, const MergeItem& externalItem,
 // index
 void writeRemovalIndex(const BWT* pBWTInternal, const std::string& sai_inname,
                        const std::string& bwt_outname, const std::string& sai_outname, 
+                       const std::string& kept_outname,
                        size_t num_strings_remove, size_t num_symbols_remove,
                        const GapArray* pGapArray)
 {
@@ -601,10 +605,12 @@ void writeRemovalIndex(const BWT* pBWTInternal, const std::string& sai_inname,
     // Write the header of the SAI which is just the number of strings and elements in the SAI
     pSAIWriter->writeHeader(output_strings, output_strings);
 
-    // We need to fix the IDs in the SAI. We do this by tracking
-    // the number of IDs that are removed that are lower than a given
-    // id.
-    std::vector<int> id_vector(pBWTInternal->getNumStrings(), 0);
+    // We need to fix the IDs in the SAI. We do this by marking
+    // the IDs that are kept in a bit vector. The new ID of a kept
+    // string is the number of kept IDs lower than it, its rank.
+    BitVector kept_ids(input_strings);
+    if(input_strings > 0)
+        kept_ids.setRange(0, input_strings - 1);
 
     // Calculate and write the actual string
     // The gap array marks the symbols that should be removed. We
@@ -628,11 +634,10 @@ void writeRemovalIndex(const BWT* pBWTInternal, const std::string& sai_inname,
                 SAElem e = pSAIReader->readElem(); 
             
                 // This element of the SAI will be removed,
-                // increment the id vector so we can correct
-                // the indices later
+                // clear its bit so we can correct the indices later
                 if(v > 0)
                 {
-                    id_vector[e.getID()]++;
+                    kept_ids.set(e.getID(), false);
                 }
             }
             
@@ -656,13 +661,9 @@ void writeRemovalIndex(const BWT* pBWTInternal, const std::string& sai_inname,
     // Finalize the BWT disk file
     pBWTWriter->finalize();
 
-    // Accumulate the counts for each id
-    int prev = 0;
-    for(size_t i = 0; i < id_vector.size(); ++i)
-    {
-        id_vector[i] += prev;
-        prev = id_vector[i];
-    }
+    // Index the kept ids for the rank queries
+    kept_ids.buildRankIndex();
+    assert(kept_ids.rank(input_strings) == output_strings);
 
     // Read the SAI file again, writing out the
     // corrected IDs that are not marked for removal
@@ -673,19 +674,22 @@ void writeRemovalIndex(const BWT* pBWTInternal, const std::string& sai_inname,
     {
         SAElem e = pSAIReader->readElem();
         uint64_t id = e.getID();
-        int prev_count = (id > 0) ? id_vector[id - 1] : 0;
-        int count = id_vector[id];
-        if(count == prev_count)
+        if(kept_ids.test(id))
         {
             // the current element should be output, it wasn't marked for removal
-            id -= count;
-            e.setID(id);
+            e.setID(kept_ids.rank(id));
             pSAIWriter->writeElem(e);
             ++num_sai_wrote;
         }
     }
     assert(num_sai_wrote == output_strings);
 
+    if(!kept_outname.empty())
+    {
+        std::ofstream kept_writer(kept_outname.c_str(), std::ios::binary);
+        kept_ids.write(kept_writer);
+    }
+
     delete pSAIReader;
     delete pSAIWriter;
     delete pBWTWriter;
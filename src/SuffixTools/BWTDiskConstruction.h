@@ -41,9 +41,13 @@ void mergeIndependentIndices(const std::string& readsFile1, const std::string& r
                              const std::string& sai_extension, bool doReverse, int numThreads, int storageLevel);
 
 // Compute new indices from allReadsFile without the reads in readsToRemove
+// If keptFilename is not empty, a BitVector marking the IDs of the reads
+// that were kept is written to it. The rank of a kept read in this vector
+// is its ID in the new index.
 void removeReadsFromIndices(const std::string& allReadsFile, const std::string& readsToRemove,
                              const std::string& outPrefix, const std::string& bwt_extension, 
-                             const std::string& sai_extension, bool doReverse, int numThreads);
+                             const std::string& sai_extension, bool doReverse, int numThreads,
+                             const std::string& keptFilename = "");
 
 //
 void mergeReadFiles(const std::string& readsFile1, const std::string& readsFile2, const std::string& outPrefix);
@@ -15,6 +15,7 @@
 #include "BWTIntervalCache.h"
 #include "SampledSuffixArray.h"
 #include "PopulationIndex.h"
+#include "PopulationColorIndex.h"
 #include "QualityTable.h"
 
 // A collection of indices. For some algorithms
@@ -24,7 +25,7 @@
 struct BWTIndexSet
 {
     // Constructor
-    BWTIndexSet() : pBWT(NULL), pRBWT(NULL), pCache(NULL), pSSA(NULL), pPopIdx(NULL), pQualityTable(NULL) {}
+    BWTIndexSet() : pBWT(NULL), pRBWT(NULL), pCache(NULL), pSSA(NULL), pPopIdx(NULL), pPopColors(NULL), pQualityTable(NULL) {}
 
     // Data
     const BWT* pBWT;
@@ -32,6 +33,7 @@ struct BWTIndexSet
     const BWTIntervalCache* pCache;
     const SampledSuffixArray* pSSA;
     const PopulationIndex* pPopIdx;
+    const PopulationColorIndex* pPopColors;
     const QualityTable* pQualityTable;
 };
 
@@ -0,0 +1,190 @@
+//-----------------------------------------------
+// Copyright 2012 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// PopulationColorIndex - The sample of the read
+// that each suffix of a population BWT belongs to,
+// stored as a wavelet matrix aligned with the BWT.
+//
+#include "PopulationColorIndex.h"
+#include "Util.h"
+
+static const uint32_t PCI_MAGIC_NUMBER = 0x5C010;
+
+#define PCI_READ(x) pReader->read(reinterpret_cast<char*>(&(x)), sizeof((x)));
+#define PCI_WRITE(x) pWriter->write(reinterpret_cast<const char*>(&(x)), sizeof((x)));
+
+//
+PopulationColorIndex::PopulationColorIndex() : m_numSamples(0), m_length(0)
+{
+
+}
+
+//
+PopulationColorIndex::PopulationColorIndex(const std::string& filename) : m_numSamples(0), m_length(0)
+{
+    read(filename);
+}
+
+//
+void PopulationColorIndex::build(const BWT* pBWT, const PopulationIndex* pPopIdx)
+{
+    m_numSamples = pPopIdx->getNumSamples();
+    m_length = pBWT->getBWLen();
+
+    // For each read, start from the end of the read and backtrack through the BWT,
+    // coloring every position with the sample of the read. As in the construction
+    // of the sampled suffix array, the position of the end of read i is i.
+    std::vector<uint32_t> colors(m_length);
+    size_t numStrings = pBWT->getNumStrings();
+    for(size_t i = 0; i < numStrings; ++i)
+    {
+        uint32_t color = pPopIdx->getSampleIndex(i);
+        size_t idx = i;
+        while(1)
+        {
+            colors[idx] = color;
+            char b = pBWT->getChar(idx);
+            idx = pBWT->getPC(b) + pBWT->getOcc(b, idx - 1);
+            if(b == '$')
+                break;
+        }
+    }
+
+    // One level for each bit of the largest color
+    size_t numLevels = 1;
+    while(((size_t)1 << numLevels) < m_numSamples)
+        numLevels += 1;
+
+    m_levels.assign(numLevels, BitVector(m_length));
+    m_numZeros.assign(numLevels, 0);
+
+    std::vector<uint32_t> next(m_length);
+    for(size_t level = 0; level < numLevels; ++level)
+    {
+        size_t shift = numLevels - level - 1;
+        BitVector& bv = m_levels[level];
+        for(size_t i = 0; i < m_length; ++i)
+        {
+            if((colors[i] >> shift) & 1)
+                bv.set(i, true);
+            else
+                m_numZeros[level] += 1;
+        }
+        bv.buildRankIndex();
+
+        // Stably move the positions with a zero bit in front of the ones for the next level
+        size_t zi = 0;
+        size_t oi = m_numZeros[level];
+        for(size_t i = 0; i < m_length; ++i)
+        {
+            if((colors[i] >> shift) & 1)
+                next[oi++] = colors[i];
+            else
+                next[zi++] = colors[i];
+        }
+        colors.swap(next);
+    }
+}
+
+//
+std::vector<size_t> PopulationColorIndex::countSampleOccurrences(const BWTInterval& interval) const
+{
+    std::vector<size_t> counts(m_numSamples, 0);
+    if(interval.isValid())
+    {
+        assert(interval.lower >= 0 && (size_t)interval.upper < m_length);
+        countRange(0, interval.lower, interval.upper + 1, 0, counts);
+    }
+    return counts;
+}
+
+// The positions of [s, e) with a zero bit in this level are in
+// [rank0(s), rank0(e)) of the next level, the positions with a one
+// bit are in [Z + rank1(s), Z + rank1(e)). Ranges without any
+// positions are not followed, so the cost depends on the number of
+// distinct colors in the interval.
+void PopulationColorIndex::countRange(size_t level, size_t s, size_t e, size_t value, std::vector<size_t>& counts) const
+{
+    if(s == e)
+        return;
+
+    if(level == m_levels.size())
+    {
+        counts[value] += e - s;
+        return;
+    }
+
+    const BitVector& bv = m_levels[level];
+    size_t ones_s = bv.rank(s);
+    size_t ones_e = bv.rank(e);
+    countRange(level + 1, s - ones_s, e - ones_e, value << 1, counts);
+
+    size_t zeros = m_numZeros[level];
+    countRange(level + 1, zeros + ones_s, zeros + ones_e, (value << 1) | 1, counts);
+}
+
+//
+void PopulationColorIndex::printInfo() const
+{
+    printf("PopulationColorIndex info:\n");
+    printf("Samples: %zu\n", m_numSamples);
+    printf("Positions: %zu\n", m_length);
+    printf("Levels: %zu\n", m_levels.size());
+}
+
+//
+void PopulationColorIndex::write(const std::string& filename) const
+{
+    std::ostream* pWriter = createWriter(filename, std::ios::out | std::ios::binary);
+    uint64_t numSamples = m_numSamples;
+    uint64_t length = m_length;
+    uint64_t numLevels = m_levels.size();
+    PCI_WRITE(PCI_MAGIC_NUMBER)
+    PCI_WRITE(numSamples)
+    PCI_WRITE(length)
+    PCI_WRITE(numLevels)
+
+    for(size_t i = 0; i < m_levels.size(); ++i)
+    {
+        uint64_t zeros = m_numZeros[i];
+        PCI_WRITE(zeros)
+        m_levels[i].write(*pWriter);
+    }
+    delete pWriter;
+}
+
+//
+void PopulationColorIndex::read(const std::string& filename)
+{
+    std::istream* pReader = createReader(filename, std::ios::binary);
+    uint32_t magic = 0;
+    uint64_t numSamples = 0;
+    uint64_t length = 0;
+    uint64_t numLevels = 0;
+    PCI_READ(magic)
+    if(magic != PCI_MAGIC_NUMBER)
+    {
+        std::cerr << "Error: " << filename << " is not a population color index\n";
+        exit(EXIT_FAILURE);
+    }
+
+    PCI_READ(numSamples)
+    PCI_READ(length)
+    PCI_READ(numLevels)
+    m_numSamples = numSamples;
+    m_length = length;
+
+    m_levels.assign(numLevels, BitVector());
+    m_numZeros.assign(numLevels, 0);
+    for(size_t i = 0; i < numLevels; ++i)
+    {
+        uint64_t zeros = 0;
+        PCI_READ(zeros)
+        m_numZeros[i] = zeros;
+        m_levels[i].read(*pReader);
+    }
+    delete pReader;
+}
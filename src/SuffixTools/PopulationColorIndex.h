@@ -0,0 +1,62 @@
+//-----------------------------------------------
+// Copyright 2012 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// PopulationColorIndex - The sample of the read
+// that each suffix of a population BWT belongs to,
+// stored as a wavelet matrix aligned with the BWT.
+// The number of suffixes of an interval that belong
+// to each sample can be counted without looking up
+// the read indices of the suffixes.
+//
+#ifndef POPULATION_COLOR_INDEX_H
+#define POPULATION_COLOR_INDEX_H
+
+#include "BWT.h"
+#include "BWTInterval.h"
+#include "PopulationIndex.h"
+#include "BitVector.h"
+
+class PopulationColorIndex
+{
+    public:
+        PopulationColorIndex();
+        PopulationColorIndex(const std::string& filename);
+
+        // Build the color of every position of pBWT using the population index
+        void build(const BWT* pBWT, const PopulationIndex* pPopIdx);
+
+        // Returns the number of suffixes in the interval that belong to each sample
+        std::vector<size_t> countSampleOccurrences(const BWTInterval& interval) const;
+
+        // Returns the number of samples in the population
+        size_t getNumSamples() const { return m_numSamples; }
+
+        // Returns the number of BWT positions that are colored
+        size_t getLength() const { return m_length; }
+
+        void printInfo() const;
+
+        // I/O
+        void write(const std::string& filename) const;
+        void read(const std::string& filename);
+
+    private:
+
+        // Add the colors of the positions [s, e) of level to counts.
+        // value holds the bits of the color above this level.
+        void countRange(size_t level, size_t s, size_t e, size_t value, std::vector<size_t>& counts) const;
+
+        // Each level holds one bit of the colors, starting with the highest bit.
+        // The positions of a level are stably sorted by the bits of the levels above
+        // it, with the zeros first. m_numZeros holds the number of zeros in each level.
+        std::vector<BitVector> m_levels;
+        std::vector<size_t> m_numZeros;
+
+        size_t m_numSamples;
+        size_t m_length;
+};
+
+#endif
@@ -75,6 +75,27 @@ std::vector<PopulationMember>::const_iterator PopulationIndex::getIterByReadInde
     return iter;
 }
 
+// As the indices are sorted the samples are found by a single
+// merge with the members of the population, rather than
+// a binary search for each index
+std::vector<size_t> PopulationIndex::countSampleReads(const std::vector<size_t>& sorted_indices) const
+{
+    std::vector<size_t> counts(m_population.size(), 0);
+    if(sorted_indices.empty())
+        return counts;
+
+    std::vector<PopulationMember>::const_iterator iter = getIterByReadIndex(sorted_indices.front());
+    for(size_t i = 0; i < sorted_indices.size(); ++i)
+    {
+        assert(i == 0 || sorted_indices[i - 1] <= sorted_indices[i]);
+        assert(sorted_indices[i] <= m_population.back().end);
+        while(sorted_indices[i] > iter->end)
+            ++iter;
+        counts[iter - m_population.begin()] += 1;
+    }
+    return counts;
+}
+
 //
 StringVector PopulationIndex::getSamples() const
 {
@@ -40,6 +40,10 @@ class PopulationIndex
         // Return the index of the sample containing the given read index
         size_t getSampleIndex(size_t read_index) const;
         
+        // Count the number of read indices in each sample.
+        // The read indices must be sorted.
+        std::vector<size_t> countSampleReads(const std::vector<size_t>& sorted_indices) const;
+
         // Get the names of all samples in the collection
         StringVector getSamples() const;
         
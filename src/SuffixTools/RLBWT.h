@@ -117,6 +117,26 @@ class RLBWT
 
         inline BaseCount getPC(char b) const { return m_predCount.get(b); }
 
+        // Prefetch the markers that are read to calculate the occurrence counts at idx.
+        // Callers that look up many independent positions prefetch ahead of the lookup
+        // so the cache misses overlap.
+        inline void prefetchMarkers(size_t idx) const
+        {
+            ++idx;
+            size_t small_idx = getNearestMarkerIdx(idx, m_smallSampleRate, m_smallShiftValue);
+            __builtin_prefetch(&m_smallMarkers[small_idx]);
+            __builtin_prefetch(&m_largeMarkers[(small_idx << m_smallShiftValue) >> m_largeShiftValue]);
+        }
+
+        // Prefetch the run-length units that are read to calculate the occurrence counts
+        // at idx. This reads the markers so they should be prefetched earlier.
+        inline void prefetchSymbols(size_t idx) const
+        {
+            ++idx;
+            const LargeMarker marker = getNearestMarker(idx);
+            __builtin_prefetch(&m_rlString[0] + marker.unitIndex);
+        }
+
         // Return the number of times char b appears in bwt[0, idx]
         inline BaseCount getOcc(char b, size_t idx) const
         {
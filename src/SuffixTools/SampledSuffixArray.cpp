@@ -86,6 +86,57 @@ size_t SampledSuffixArray::lookupLexoRank(size_t r) const
     return m_saLexoIndex[r];
 }
 
+// When only the lexicographic index is loaded, the suffixes of the interval
+// are backtracked together. The interval is split on the preceding symbol of
+// each suffix, the suffixes preceded by '$' are the starts of reads and their IDs
+// are looked up directly in the lexicographic index. Suffixes that share their
+// preceding sequence, like reads sampled from the same place in the genome, are only
+// backtracked once.
+void SampledSuffixArray::calcReadIDs(const BWTInterval& interval, const BWT* pBWT, std::vector<size_t>& outIDs) const
+{
+    if(m_sampleRate > 0)
+    {
+        for(int64_t j = interval.lower; j <= interval.upper; ++j)
+            outIDs.push_back(calcSA(j, pBWT).getID());
+        return;
+    }
+
+    std::vector<BWTInterval> stack(1, interval);
+    while(!stack.empty())
+    {
+        BWTInterval curr = stack.back();
+        stack.pop_back();
+        if(!curr.isValid())
+            continue;
+
+        AlphaCount64 lower = pBWT->getFullOcc(curr.lower - 1);
+        AlphaCount64 upper = pBWT->getFullOcc(curr.upper);
+        for(size_t i = 0; i < BWT_ALPHABET::size; ++i)
+        {
+            char b = BWT_ALPHABET::getChar(i);
+            size_t lo = lower.get(b);
+            size_t hi = upper.get(b);
+            if(lo == hi)
+                continue;
+
+            if(b == '$')
+            {
+                // The rank of the read is the position of its '$'
+                for(size_t r = lo; r < hi; ++r)
+                {
+                    assert(r < m_saLexoIndex.size());
+                    outIDs.push_back(m_saLexoIndex[r]);
+                }
+            }
+            else
+            {
+                size_t pb = pBWT->getPC(b);
+                stack.push_back(BWTInterval(pb + lo, pb + hi - 1));
+            }
+        }
+    }
+}
+
 // 
 void SampledSuffixArray::build(const BWT* pBWT, const ReadInfoTable* pRIT, int sampleRate)
 {
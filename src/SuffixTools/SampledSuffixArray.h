@@ -14,6 +14,7 @@
 
 #include "SuffixArray.h"
 #include "BWT.h"
+#include "BWTInterval.h"
 #include "ReadInfoTable.h"
 
 typedef uint32_t SSA_INT_TYPE;
@@ -37,6 +38,10 @@ class SampledSuffixArray
         // Returns the ID of the read with lexicographic rank r
         size_t lookupLexoRank(size_t r) const;
 
+        // Append the IDs of the reads containing the suffixes in the interval to outIDs.
+        // A read is added once for every suffix of it in the interval.
+        void calcReadIDs(const BWTInterval& interval, const BWT* pBWT, std::vector<size_t>& outIDs) const;
+
         // Construct the sampled SA using the bwt of a set of reads and their lengths
         void build(const BWT* pBWT, const ReadInfoTable* pRIT, int sampleRate = DEFAULT_SA_SAMPLE_RATE);
 
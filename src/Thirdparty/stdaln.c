@@ -522,6 +522,155 @@ int aln_global_core(unsigned char *seq1, int len1, unsigned char *seq2, int len2
 	
 	return max;
 }
+/*
+ * Score-only variant of aln_global_core(). The recurrences and the band are
+ * identical but no traceback matrix is kept, so the memory is O(len1) and
+ * each cell is a handful of branch-free max operations.
+ */
+#define max2_score(a, b) ((a) > (b)? (a) : (b))
+#define score_M(MM, p, sc) { (MM) = max2_score(max2_score((p)->M, (p)->I), (p)->D) + (sc); }
+#define score_I(II, p) { (II) = max2_score((p)->M - gap_open, (p)->I) - gap_ext; }
+#define score_end_I(II, p) { (II) = max2_score((p)->M - gap_open, (p)->I) - (gap_end >= 0? gap_end : gap_ext); }
+#define score_D(DD, p) { (DD) = max2_score((p)->M - gap_open, (p)->D) - gap_ext; }
+#define score_end_D(DD, p) { (DD) = max2_score((p)->M - gap_open, (p)->D) - (gap_end >= 0? gap_end : gap_ext); }
+
+int aln_global_score(unsigned char *seq1, int len1, unsigned char *seq2, int len2, const AlnParam *ap)
+{
+	register int i, j;
+	dpscore_t *curr, *last, *s;
+	int b1, b2, tmp_end;
+	int *mat, end, max;
+
+	int gap_open, gap_ext, gap_end, b;
+	int *score_matrix, N_MATRIX_ROW;
+
+	gap_open = ap->gap_open;
+	gap_ext = ap->gap_ext;
+	gap_end = ap->gap_end;
+	b = ap->band_width;
+	score_matrix = ap->matrix;
+	N_MATRIX_ROW = ap->row;
+
+	if (len1 == 0 || len2 == 0) return 0;
+
+	/* calculate b1 and b2 */
+	if (len1 > len2) {
+		b1 = len1 - len2 + b;
+		b2 = b;
+	} else {
+		b1 = b;
+		b2 = len2 - len1 + b;
+	}
+	if (b1 > len1) b1 = len1;
+	if (b2 > len2) b2 = len2;
+	--seq1; --seq2;
+
+	curr = (dpscore_t*)malloc(sizeof(dpscore_t) * (len1 + 1));
+	last = (dpscore_t*)malloc(sizeof(dpscore_t) * (len1 + 1));
+
+	/* set first row */
+	SET_INF(*curr); curr->M = 0;
+	for (i = 1, s = curr + 1; i < b1; ++i, ++s) {
+		SET_INF(*s);
+		score_end_D(s->D, s - 1);
+	}
+	s = curr; curr = last; last = s;
+
+	/* core dynamic programming, part 1 */
+	tmp_end = (b2 < len2)? b2 : len2 - 1;
+	for (j = 1; j <= tmp_end; ++j) {
+		s = curr; SET_INF(*s);
+		score_end_I(s->I, last);
+		end = (j + b1 <= len1 + 1)? (j + b1 - 1) : len1;
+		mat = score_matrix + seq2[j] * N_MATRIX_ROW;
+		++s;
+		for (i = 1; i != end; ++i, ++s) {
+			score_M(s->M, last + i - 1, mat[seq1[i]]);
+			score_I(s->I, last + i);
+			score_D(s->D, s - 1);
+		}
+		score_M(s->M, last + i - 1, mat[seq1[i]]);
+		score_D(s->D, s - 1);
+		if (j + b1 - 1 > len1) {
+			score_end_I(s->I, last + i);
+		} else s->I = MINOR_INF;
+		s = curr; curr = last; last = s;
+	}
+	/* last row for part 1 */
+	if (j == len2 && b2 != len2 - 1) {
+		s = curr; SET_INF(*s);
+		score_end_I(s->I, last);
+		end = (j + b1 <= len1 + 1)? (j + b1 - 1) : len1;
+		mat = score_matrix + seq2[j] * N_MATRIX_ROW;
+		++s;
+		for (i = 1; i != end; ++i, ++s) {
+			score_M(s->M, last + i - 1, mat[seq1[i]]);
+			score_I(s->I, last + i);
+			score_end_D(s->D, s - 1);
+		}
+		score_M(s->M, last + i - 1, mat[seq1[i]]);
+		score_end_D(s->D, s - 1);
+		if (j + b1 - 1 > len1) {
+			score_end_I(s->I, last + i);
+		} else s->I = MINOR_INF;
+		s = curr; curr = last; last = s;
+		++j;
+	}
+
+	/* core dynamic programming, part 2 */
+	for (; j <= len2 - b2 + 1; ++j) {
+		SET_INF(curr[j - b2]);
+		mat = score_matrix + seq2[j] * N_MATRIX_ROW;
+		end = j + b1 - 1;
+		for (i = j - b2 + 1, s = curr + i; i != end; ++i, ++s) {
+			score_M(s->M, last + i - 1, mat[seq1[i]]);
+			score_I(s->I, last + i);
+			score_D(s->D, s - 1);
+		}
+		score_M(s->M, last + i - 1, mat[seq1[i]]);
+		score_D(s->D, s - 1);
+		s->I = MINOR_INF;
+		s = curr; curr = last; last = s;
+	}
+
+	/* core dynamic programming, part 3 */
+	for (; j < len2; ++j) {
+		SET_INF(curr[j - b2]);
+		mat = score_matrix + seq2[j] * N_MATRIX_ROW;
+		for (i = j - b2 + 1, s = curr + i; i < len1; ++i, ++s) {
+			score_M(s->M, last + i - 1, mat[seq1[i]]);
+			score_I(s->I, last + i);
+			score_D(s->D, s - 1);
+		}
+		score_M(s->M, last + len1 - 1, mat[seq1[i]]);
+		score_end_I(s->I, last + i);
+		score_D(s->D, s - 1);
+		s = curr; curr = last; last = s;
+	}
+	/* last row */
+	if (j == len2) {
+		SET_INF(curr[j - b2]);
+		mat = score_matrix + seq2[j] * N_MATRIX_ROW;
+		for (i = j - b2 + 1, s = curr + i; i < len1; ++i, ++s) {
+			score_M(s->M, last + i - 1, mat[seq1[i]]);
+			score_I(s->I, last + i);
+			score_end_D(s->D, s - 1);
+		}
+		score_M(s->M, last + len1 - 1, mat[seq1[i]]);
+		score_end_I(s->I, last + i);
+		score_end_D(s->D, s - 1);
+		s = curr; curr = last; last = s;
+	}
+
+	/* the score is the best of the three states of the last cell */
+	s = last + len1;
+	max = s->M;
+	if (s->I > max) max = s->I;
+	if (s->D > max) max = s->D;
+
+	free(curr); free(last);
+	return max;
+}
 /*************************************************
  * local alignment combined with banded strategy *
  *************************************************/
@@ -126,6 +126,7 @@ extern "C" {
 
 	int aln_global_core(unsigned char *seq1, int len1, unsigned char *seq2, int len2, const AlnParam *ap,
 						path_t *path, int *path_len);
+	int aln_global_score(unsigned char *seq1, int len1, unsigned char *seq2, int len2, const AlnParam *ap);
 	int aln_local_core(unsigned char *seq1, int len1, unsigned char *seq2, int len2, const AlnParam *ap,
 					   path_t *path, int *path_len, int _thres, int *_subo);
 	int aln_extend_core(unsigned char *seq1, int len1, unsigned char *seq2, int len2, const AlnParam *ap,
@@ -8,85 +8,196 @@
 //
 #include "BitVector.h"
 #include <assert.h>
-#include <cstdlib>
+#include <stdlib.h>
+#include <algorithm>
 
 //
-BitVector::BitVector()
+BitVector::BitVector() : m_size(0)
 {
-    initializeMutex();
+
 }
 
 //
-BitVector::BitVector(size_t n)
+BitVector::BitVector(size_t n) : m_size(0)
 {
-    initializeMutex();
     resize(n);
 }
 
-void BitVector::initializeMutex()
+//
+void BitVector::resize(size_t n)
 {
-    int ret = pthread_mutex_init(&m_mutex, NULL);
-    if(ret != 0)
+    m_size = n;
+    size_t num_words = (n + 63) / 64;
+    m_data.resize(num_words, 0);
+    
+    // Clear the bits past the end of the last word
+    // in case the vector was shrunk
+    if(n % 64 != 0)
+        m_data.back() &= getMask(n) - 1;
+    m_blockRank.clear();
+}
+
+//
+bool BitVector::updateCAS(size_t i, bool oldValue, bool newValue)
+{
+    assert(oldValue != newValue);
+    (void)oldValue;
+
+    size_t word = i / 64;
+    assert(word < m_data.size());
+    uint64_t mask = getMask(i);
+    if(newValue)
     {
-        std::cerr << "Mutex initialization in BitVector failed with error " << ret << ", aborting" << std::endl;
-        exit(EXIT_FAILURE);
+        uint64_t oldWord = __sync_fetch_and_or(&m_data[word], mask);
+        return (oldWord & mask) == 0;
+    }
+    else
+    {
+        uint64_t oldWord = __sync_fetch_and_and(&m_data[word], ~mask);
+        return (oldWord & mask) != 0;
     }
 }
 
 //
-BitVector::~BitVector()
+size_t BitVector::setRange(size_t first, size_t last)
 {
-    int ret = pthread_mutex_destroy(&m_mutex);
-    if(ret != 0)
+    assert(first <= last && last < m_size);
+    size_t first_word = first / 64;
+    size_t last_word = last / 64;
+    size_t num_changed = 0;
+    for(size_t w = first_word; w <= last_word; ++w)
     {
-        std::cerr << "Mutex destruction in BitVector failed with error " << ret << ", aborting" << std::endl;
-        exit(EXIT_FAILURE);
+        uint64_t mask = ~(uint64_t)0;
+        if(w == first_word)
+            mask &= ~(getMask(first) - 1);
+        if(w == last_word && last % 64 != 63)
+            mask &= getMask(last + 1) - 1;
+
+        // Skip the atomic operation if the bits are already set
+        if((m_data[w] & mask) == mask)
+            continue;
+        uint64_t oldWord = __sync_fetch_and_or(&m_data[w], mask);
+        num_changed += popcount(mask & ~oldWord);
     }
+    return num_changed;
 }
 
-//
-void BitVector::resize(size_t n)
+// Set bit at position i to value v
+void BitVector::set(size_t i, bool v)
 {
-    size_t num_bytes = (n % 8 == 0) ? n / 8 : (n / 8) + 1;
-    m_data.resize(num_bytes);
+    size_t word = i / 64;
+    assert(word < m_data.size());
+    if(v)
+        m_data[word] |= getMask(i);
+    else
+        m_data[word] &= ~getMask(i);
 }
 
-//
-void BitVector::lock()
+// Test bit i
+bool BitVector::test(size_t i) const
 {
-    pthread_mutex_lock(&m_mutex);
+    return m_data[i / 64] & getMask(i);
 }
 
 //
-void BitVector::unlock()
+size_t BitVector::count() const
 {
-    pthread_mutex_unlock(&m_mutex);
+    size_t n = 0;
+    for(size_t w = 0; w < m_data.size(); ++w)
+        n += popcount(m_data[w]);
+    return n;
 }
 
 //
-bool BitVector::updateCAS(size_t i, bool oldValue, bool newValue)
+void BitVector::buildRankIndex()
 {
-    size_t byte = i / 8;
-    assert(byte < m_data.size());
-    size_t offset = i - byte * 8;
-    return m_data[byte].updateCAS(offset, oldValue, newValue);
+    size_t num_blocks = (m_data.size() + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK;
+    m_blockRank.resize(num_blocks + 1);
+    uint64_t total = 0;
+    for(size_t b = 0; b < num_blocks; ++b)
+    {
+        m_blockRank[b] = total;
+        size_t end = std::min((b + 1) * WORDS_PER_BLOCK, m_data.size());
+        for(size_t w = b * WORDS_PER_BLOCK; w < end; ++w)
+            total += popcount(m_data[w]);
+    }
+    m_blockRank[num_blocks] = total;
 }
 
+//
+size_t BitVector::rank(size_t i) const
+{
+    assert(i <= m_size);
+    assert(!m_blockRank.empty() || m_data.empty());
+    size_t word = i / 64;
+    size_t block = word / WORDS_PER_BLOCK;
+    size_t r = m_data.empty() ? 0 : m_blockRank[block];
+    for(size_t w = block * WORDS_PER_BLOCK; w < word; ++w)
+        r += popcount(m_data[w]);
+    if(i % 64 != 0)
+        r += popcount(m_data[word] & (getMask(i) - 1));
+    return r;
+}
 
-// Set bit at position i to value v
-void BitVector::set(size_t i, bool v)
+//
+size_t BitVector::select(size_t r) const
 {
-    size_t byte = i / 8;
-    assert(byte < m_data.size());
-    size_t offset = i - byte * 8;
-    m_data[byte].set(offset, v);
+    assert(!m_blockRank.empty() || m_data.empty());
+    if(m_data.empty() || r >= m_blockRank.back())
+        return m_size;
+
+    // Find the last block whose rank is <= r
+    std::vector<uint64_t>::const_iterator iter = std::upper_bound(m_blockRank.begin(), m_blockRank.end(), (uint64_t)r);
+    size_t block = (iter - m_blockRank.begin()) - 1;
+    size_t remaining = r - m_blockRank[block];
+
+    // Scan the words of the block
+    size_t w = block * WORDS_PER_BLOCK;
+    size_t c = popcount(m_data[w]);
+    while(c <= remaining)
+    {
+        remaining -= c;
+        c = popcount(m_data[++w]);
+    }
+
+    // Clear the lowest set bits of the word until the target is the lowest
+    uint64_t word = m_data[w];
+    for(size_t j = 0; j < remaining; ++j)
+        word &= word - 1;
+    return w * 64 + __builtin_ctzll(word);
 }
 
-// Test bit i
-bool BitVector::test(size_t i) const
+//
+void BitVector::write(std::ostream& out) const
 {
-    size_t byte = i / 8;
-    size_t offset = i - byte * 8;
-    return m_data[byte].test(offset);
+    uint64_t n = m_size;
+    out.write((const char*)&BITVECTOR_FILE_MAGIC, sizeof(BITVECTOR_FILE_MAGIC));
+    out.write((const char*)&n, sizeof(n));
+    if(!m_data.empty())
+        out.write((const char*)&m_data[0], m_data.size() * sizeof(uint64_t));
 }
 
+//
+void BitVector::read(std::istream& in)
+{
+    uint16_t magic = 0;
+    uint64_t n = 0;
+    in.read((char*)&magic, sizeof(magic));
+    in.read((char*)&n, sizeof(n));
+    if(!in || magic != BITVECTOR_FILE_MAGIC)
+    {
+        std::cerr << "Error: invalid bit vector file\n";
+        exit(EXIT_FAILURE);
+    }
+
+    m_data.clear();
+    resize(n);
+    if(!m_data.empty())
+        in.read((char*)&m_data[0], m_data.size() * sizeof(uint64_t));
+    if(!in)
+    {
+        std::cerr << "Error: bit vector file is truncated\n";
+        exit(EXIT_FAILURE);
+    }
+    buildRankIndex();
+}
@@ -4,14 +4,25 @@
 // Released under the GPL
 //-----------------------------------------------
 //
-// BitVector - Vector of bits. The structure
-// can be locked by a mutex to guarentee atomic access.
+// BitVector - Vector of bits stored in 64-bit words.
+// Bits can be set and cleared atomically by multiple
+// threads using updateCAS() and setRange().
+// After the bits have been set, rank/select queries
+// can be answered once buildRankIndex() has been called.
+// This allows a vector marking the reads that are kept
+// by a filtering step to map read IDs between indices:
+// the new ID of kept read i is rank(i) and the original
+// ID of new read j is select(j).
 //
 #ifndef BITVECTOR_H
 #define BITVECTOR_H
 
-#include "BitChar.h"
 #include <vector>
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+
+const uint16_t BITVECTOR_FILE_MAGIC = 0xB17E;
 
 class BitVector
 {
@@ -19,31 +30,59 @@ class BitVector
     
         BitVector();
         BitVector(size_t n);
-        ~BitVector();
-
-        // Functions to acquire/release the mutex
-        // The client code is responsible for acquiring
-        // the lock before calling set(). Reading a bit with 
-        // test() is ok however.
-        void lock();
-        void unlock();
 
-        // Update the bit at position i from oldValue to newValue using a
-        // compare and swap operation. Returns true if the update is successful.
+        // Update the bit at position i from oldValue to newValue using an
+        // atomic fetch-and-or/fetch-and-and on the word containing the bit.
+        // Returns true if this call changed the bit, false if it already
+        // had the value newValue.
         bool updateCAS(size_t i, bool oldValue, bool newValue);
 
+        // Atomically set all the bits in [first, last] to 1.
+        // Returns the number of bits that were changed by this call.
+        size_t setRange(size_t first, size_t last);
+
         void resize(size_t n);
+
+        // Set bit i to v. This is not atomic, use updateCAS()
+        // when other threads may modify the same word.
         void set(size_t i, bool v);
         bool test(size_t i) const;
 
-        size_t capacity() const { return m_data.size() * 8; }
+        // Returns the number of bits
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_data.size() * 64; }
+
+        // Returns the number of set bits
+        size_t count() const;
+
+        // Build the index used by rank() and select().
+        // It must be rebuilt after the bits are modified.
+        void buildRankIndex();
+
+        // Returns the number of set bits in [0, i)
+        size_t rank(size_t i) const;
+
+        // Returns the position of the set bit with rank r, that is the
+        // (r+1)-th set bit. Returns size() if there are not enough set bits.
+        size_t select(size_t r) const;
+
+        // I/O
+        // The rank index is not written, it is rebuilt by read()
+        void write(std::ostream& out) const;
+        void read(std::istream& in);
 
     private:
 
-        void initializeMutex();
+        static const size_t WORDS_PER_BLOCK = 8;
+
+        static inline uint64_t getMask(size_t i) { return (uint64_t)1 << (i & 63); }
+        static inline size_t popcount(uint64_t w) { return __builtin_popcountll(w); }
+
+        std::vector<uint64_t> m_data;
+        size_t m_size;
 
-        std::vector<BitChar> m_data;
-        pthread_mutex_t m_mutex;
+        // The number of set bits before each block of WORDS_PER_BLOCK words
+        std::vector<uint64_t> m_blockRank;
 };
 
 #endif
@@ -12,7 +12,7 @@
 //#define TRACK_OCCUPANCY 1
 
 //
-BloomFilter::BloomFilter() : m_occupancy(0), m_test_counter(0)
+BloomFilter::BloomFilter() : m_offset(0), m_num_blocks(0), m_num_hashes(0), m_seed(0), m_width(0), m_occupancy(0), m_test_counter(0)
 {
 
 }
@@ -20,43 +20,72 @@ BloomFilter::BloomFilter() : m_occupancy(0), m_test_counter(0)
 //
 void BloomFilter::initialize(size_t width, size_t num_hashes)
 {
-    m_width = width;
-    m_bitvector.resize(width);
+    // Round the width up to a whole number of blocks
+    m_num_blocks = (width + BLOCK_BITS - 1) / BLOCK_BITS;
+    if(m_num_blocks == 0)
+        m_num_blocks = 1;
+    m_width = m_num_blocks * BLOCK_BITS;
+    m_num_hashes = num_hashes;
     m_occupancy = 0;
 
-    // Create seeds for murmer hash
-    // TODO: Check how independent this method of selecting
-    // hash function is...
-    m_hashes.resize(num_hashes);
-    for(size_t i = 0; i < m_hashes.size(); ++i)
-        m_hashes[i] = rand();
+    // Allocate one extra block so the first block can be aligned to a cache line
+    m_words.assign((m_num_blocks + 1) * BLOCK_WORDS, 0);
+    size_t misalign = (reinterpret_cast<size_t>(&m_words[0]) / sizeof(uint64_t)) % BLOCK_WORDS;
+    m_offset = misalign == 0 ? 0 : BLOCK_WORDS - misalign;
+
+    // Seed for murmer hash
+    m_seed = rand();
+}
+
+//
+uint64_t* BloomFilter::getBlock(uint64_t h) const
+{
+    size_t block = h % m_num_blocks;
+    return const_cast<uint64_t*>(&m_words[m_offset + block * BLOCK_WORDS]);
+}
+
+//
+void BloomFilter::getBlockMask(uint64_t h, uint64_t* mask) const
+{
+    for(size_t i = 0; i < BLOCK_WORDS; ++i)
+        mask[i] = 0;
+
+    // Double hashing, the increment is odd so the positions
+    // cycle through the entire block
+    uint32_t a = h & 0xFFFFFFFF;
+    uint32_t b = (h >> 32) | 1;
+    for(size_t i = 0; i < m_num_hashes; ++i)
+    {
+        uint32_t bit = (a + i * b) % BLOCK_BITS;
+        mask[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
 }
 
 //
 void BloomFilter::add(const void* key, int num_bytes)
 {
-    // Set h bits
-    for(size_t i = 0; i < m_hashes.size(); ++i) {
-        int64_t h[2];
-        MurmurHash3_x64_128(key, num_bytes, m_hashes[i], &h);
-        size_t idx = h[0] % m_width;
+    uint64_t h[2];
+    MurmurHash3_x64_128(key, num_bytes, m_seed, &h);
+    uint64_t* block = getBlock(h[0]);
 
-        bool was_set = m_bitvector.updateCAS(idx, false, true);
+    uint64_t mask[BLOCK_WORDS];
+    getBlockMask(h[1], mask);
+    for(size_t i = 0; i < BLOCK_WORDS; ++i)
+    {
+        // Skip the atomic operation if there is nothing new to set
+        if((block[i] & mask[i]) == mask[i])
+            continue;
+
+        uint64_t old_word = __sync_fetch_and_or(&block[i], mask[i]);
 #if TRACK_OCCUPANCY
-        // This call uses an atomic update and returns true if the
-        // bit was sucessfully set
-        if(was_set)
-        {
-            // A bit was set, update the occupancy
-            bool set = false;
-            do {
-                size_t old_occ = m_occupancy;
-                size_t new_occ = old_occ + 1;
-                set = __sync_bool_compare_and_swap(&m_occupancy, old_occ, new_occ);
-            } while(!set);
-        }
+        // Count the bits that were set by this update
+        uint64_t new_bits = mask[i] & ~old_word;
+        size_t count = 0;
+        for(; new_bits != 0; new_bits &= new_bits - 1)
+            count += 1;
+        __sync_fetch_and_add(&m_occupancy, count);
 #else
-        (void)was_set;
+        (void)old_word;
 #endif
     }
 }
@@ -64,11 +93,15 @@ void BloomFilter::add(const void* key, int num_bytes)
 //
 bool BloomFilter::test(const void* key, int num_bytes) const
 {
-    for(size_t i = 0; i < m_hashes.size(); ++i) {
-        int64_t h[2];
-        MurmurHash3_x64_128(key, num_bytes, m_hashes[i], &h);
-        size_t idx = h[0] % m_width;
-        if(!m_bitvector.test(idx))
+    uint64_t h[2];
+    MurmurHash3_x64_128(key, num_bytes, m_seed, &h);
+    const uint64_t* block = getBlock(h[0]);
+
+    uint64_t mask[BLOCK_WORDS];
+    getBlockMask(h[1], mask);
+    for(size_t i = 0; i < BLOCK_WORDS; ++i)
+    {
+        if((block[i] & mask[i]) != mask[i])
             return false;
     }
 
@@ -87,15 +120,19 @@ bool BloomFilter::test(const void* key, int num_bytes) const
 void BloomFilter::printOccupancy() const
 {
     size_t set_count = 0;
-    for(size_t i = 0; i < m_width; ++i)
-        set_count += m_bitvector.test(i);
+    for(size_t i = 0; i < m_num_blocks * BLOCK_WORDS; ++i)
+    {
+        uint64_t w = m_words[m_offset + i];
+        for(; w != 0; w &= w - 1)
+            set_count += 1;
+    }
     printf("%zu out of %zu bits are set\n", set_count, m_width);
 }
 
 //
 void BloomFilter::printMemory() const
 {
-    size_t bytes = m_bitvector.capacity();
+    size_t bytes = m_words.capacity() * sizeof(uint64_t);
     double mb = (double)bytes / (1 << 20);
     printf("BloomFilter using %.1lf MB\n", mb);
 }
@@ -10,8 +10,16 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <limits>
-#include "BitVector.h"
 
+//
+// BloomFilter - A cache-blocked bloom filter. The bits are split
+// into 512-bit blocks, one cache line each. A key is hashed once with
+// MurmurHash3_x64_128; the first half of the hash selects the block
+// and the second half generates all num_hashes bit positions within
+// the block by double hashing. Adding or testing a key therefore costs
+// one hash and touches one cache line. Bits are set with a word-level
+// atomic OR so add() can be called from multiple threads.
+//
 class BloomFilter
 {
     public:
@@ -59,8 +67,23 @@ class BloomFilter
         void printOccupancy() const;
 
     private:
-        BitVector m_bitvector;
-        std::vector<uint32_t> m_hashes;
+
+        static const size_t BLOCK_BITS = 512;
+        static const size_t BLOCK_WORDS = BLOCK_BITS / 64;
+
+        // Return a pointer to the first word of the block for the hash value
+        uint64_t* getBlock(uint64_t h) const;
+
+        // Compute the mask of bits to set in each word of a block
+        void getBlockMask(uint64_t h, uint64_t* mask) const;
+
+        // The words of the filter. m_offset is the index of the first
+        // word, chosen so the blocks are aligned to cache lines.
+        std::vector<uint64_t> m_words;
+        size_t m_offset;
+        size_t m_num_blocks;
+        size_t m_num_hashes;
+        uint32_t m_seed;
         size_t m_width;
         size_t m_occupancy;
         mutable size_t m_test_counter;
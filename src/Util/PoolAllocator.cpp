@@ -0,0 +1,106 @@
+//-----------------------------------------------
+// Copyright 2010 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// PoolAllocator - An STL allocator that recycles
+// small allocations through per-thread free lists
+//
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <iostream>
+#include "PoolAllocator.h"
+
+// The per-thread pools are stored in thread specific data
+// so they are deleted when the thread exits
+static pthread_key_t s_poolKey;
+static pthread_once_t s_poolKeyOnce = PTHREAD_ONCE_INIT;
+
+static void deleteThreadPool(void* ptr)
+{
+    delete (NodePool*)ptr;
+}
+
+static void createPoolKey()
+{
+    int ret = pthread_key_create(&s_poolKey, deleteThreadPool);
+    if(ret != 0)
+    {
+        std::cerr << "Failed to create the node pool key with error " << ret << ", aborting" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+NodePool::NodePool()
+{
+    for(size_t i = 0; i < NUM_CLASSES; ++i)
+    {
+        m_freeLists[i] = NULL;
+        m_numFree[i] = 0;
+    }
+}
+
+//
+NodePool::~NodePool()
+{
+    for(size_t i = 0; i < NUM_CLASSES; ++i)
+    {
+        FreeChunk* pChunk = m_freeLists[i];
+        while(pChunk != NULL)
+        {
+            FreeChunk* pNext = pChunk->pNext;
+            ::operator delete(pChunk);
+            pChunk = pNext;
+        }
+    }
+}
+
+// Chunks are allocated with the size of their class
+// so they can be reused for any size in the class
+void* NodePool::allocate(size_t size)
+{
+    assert(size > 0 && size <= MAX_SIZE);
+    size_t c = getClass(size);
+    FreeChunk* pChunk = m_freeLists[c];
+    if(pChunk != NULL)
+    {
+        m_freeLists[c] = pChunk->pNext;
+        m_numFree[c] -= 1;
+        return pChunk;
+    }
+
+    return ::operator new((c + 1) * GRANULARITY);
+}
+
+//
+void NodePool::deallocate(void* ptr, size_t size)
+{
+    assert(size > 0 && size <= MAX_SIZE);
+    size_t c = getClass(size);
+    if(m_numFree[c] == MAX_FREE)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    FreeChunk* pChunk = static_cast<FreeChunk*>(ptr);
+    pChunk->pNext = m_freeLists[c];
+    m_freeLists[c] = pChunk;
+    m_numFree[c] += 1;
+}
+
+//
+NodePool* NodePool::getThreadPool()
+{
+    pthread_once(&s_poolKeyOnce, createPoolKey);
+    NodePool* pPool = (NodePool*)pthread_getspecific(s_poolKey);
+    if(pPool == NULL)
+    {
+        pPool = new NodePool;
+        pthread_setspecific(s_poolKey, pPool);
+    }
+    return pPool;
+}
@@ -0,0 +1,116 @@
+//-----------------------------------------------
+// Copyright 2010 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// PoolAllocator - An STL allocator that recycles
+// small allocations through per-thread free lists.
+// Containers that are filled and emptied for every
+// read, like the lists of overlap blocks, reuse
+// their nodes instead of going through malloc.
+//
+#ifndef POOLALLOCATOR_H
+#define POOLALLOCATOR_H
+
+#include <stddef.h>
+#include <new>
+
+// Free lists of memory chunks, one for each size class.
+// Each thread has its own pool so no locking is needed.
+// Memory freed by a different thread than the one that
+// allocated it is kept by the freeing thread.
+class NodePool
+{
+    public:
+
+        NodePool();
+        ~NodePool();
+
+        // Allocate or free size bytes
+        void* allocate(size_t size);
+        void deallocate(void* ptr, size_t size);
+
+        // Returns the pool owned by the calling thread
+        static NodePool* getThreadPool();
+
+        // Allocations larger than this go directly to operator new
+        static const size_t MAX_SIZE = 512;
+
+    private:
+
+        static const size_t GRANULARITY = 16;
+        static const size_t NUM_CLASSES = MAX_SIZE / GRANULARITY;
+
+        // The number of free chunks kept for each size class
+        static const size_t MAX_FREE = 4096;
+
+        struct FreeChunk
+        {
+            FreeChunk* pNext;
+        };
+
+        static size_t getClass(size_t size) { return (size - 1) / GRANULARITY; }
+
+        FreeChunk* m_freeLists[NUM_CLASSES];
+        size_t m_numFree[NUM_CLASSES];
+};
+
+// A stateless allocator using the pool of the calling thread.
+// All instances compare equal so containers using it can
+// splice and swap freely.
+template<class T>
+class PoolAllocator
+{
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<class U>
+        struct rebind
+        {
+            typedef PoolAllocator<U> other;
+        };
+
+        PoolAllocator() {}
+        PoolAllocator(const PoolAllocator&) {}
+        template<class U> PoolAllocator(const PoolAllocator<U>&) {}
+
+        pointer address(reference x) const { return &x; }
+        const_pointer address(const_reference x) const { return &x; }
+
+        pointer allocate(size_type n, const void* = 0)
+        {
+            size_t size = n * sizeof(T);
+            if(size > NodePool::MAX_SIZE)
+                return static_cast<pointer>(::operator new(size));
+            return static_cast<pointer>(NodePool::getThreadPool()->allocate(size));
+        }
+
+        void deallocate(pointer p, size_type n)
+        {
+            size_t size = n * sizeof(T);
+            if(size > NodePool::MAX_SIZE)
+                ::operator delete(p);
+            else
+                NodePool::getThreadPool()->deallocate(p, size);
+        }
+
+        size_type max_size() const { return size_t(-1) / sizeof(T); }
+
+        void construct(pointer p, const T& val) { new(p) T(val); }
+        void destroy(pointer p) { p->~T(); }
+};
+
+template<class T, class U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+
+template<class T, class U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+#endif
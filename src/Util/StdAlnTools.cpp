@@ -14,26 +14,44 @@
 // Perform a global alignment between the given strings
 int StdAlnTools::globalAlignment(const std::string& target, const std::string& query, bool bPrint)
 {
+    // The path is only needed to print the alignment
+    if(!bPrint)
+        return globalAlignmentScore(target, query);
+
     path_t* path;
     int path_len = 0;
     int score = 0;
     createGlobalAlignmentPath(target, query, &path, &path_len, &score);
 
-    if(bPrint)
-    {
-        std::string paddedTarget, paddedQuery, paddedMatch;
-        makePaddedStringsFromPath(target, query, path, path_len, paddedTarget, paddedQuery, paddedMatch);
-        printPaddedStrings(paddedTarget, paddedQuery, paddedMatch);
+    std::string paddedTarget, paddedQuery, paddedMatch;
+    makePaddedStringsFromPath(target, query, path, path_len, paddedTarget, paddedQuery, paddedMatch);
+    printPaddedStrings(paddedTarget, paddedQuery, paddedMatch);
 
-        std::cout << "CIGAR: " << makeCigar(path, path_len) << "\n";
-        std::cout << "Global alignment score: " << score << "\n";
-    }
+    std::cout << "CIGAR: " << makeCigar(path, path_len) << "\n";
+    std::cout << "Global alignment score: " << score << "\n";
 
     free(path);
 
     return score;
 }
 
+// Calculate the global alignment score without a traceback
+int StdAlnTools::globalAlignmentScore(const std::string& target, const std::string& query)
+{
+    GlobalAlnParams params;
+    AlnParam par;
+    int matrix[25];
+    StdAlnTools::setAlnParam(par, matrix, params);
+
+    uint8_t* pQueryT = createPacked(query);
+    uint8_t* pTargetT = createPacked(target);
+    int score = aln_global_score(pTargetT, target.size(), pQueryT, query.size(), &par);
+
+    delete [] pQueryT;
+    delete [] pTargetT;
+    return score;
+}
+
 // Perform a global alignment between the given strings and return the CIGAR string
 std::string StdAlnTools::globalAlignmentCigar(const std::string& target, const std::string& query)
 {
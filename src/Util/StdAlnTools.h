@@ -77,6 +77,12 @@ namespace StdAlnTools
     // The alignment score is returned.
     int globalAlignment(const std::string& target, const std::string& query, bool bPrint = false);
 
+    // Calculate the score of the global alignment between target and query
+    // without computing the alignment path. This uses the same banded
+    // dynamic programming as globalAlignment but keeps only two rows of
+    // scores, so it should be preferred when only the score is needed.
+    int globalAlignmentScore(const std::string& target, const std::string& query);
+
     // Perform a global alignment between the two strings and return a CIGAR string
     std::string globalAlignmentCigar(const std::string& target, const std::string& query);
 
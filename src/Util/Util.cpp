@@ -79,18 +79,25 @@ std::string suffix(const std::string& seq, const unsigned int len)
     return seq.substr(seq.length() - len);
 }
 
-//
-// Dust scoring scheme as given by:
-// Morgulis A. "A fast and symmetric DUST implementation to Mask
-// Low-Complexity DNA Sequences". J Comp Bio.
-double calculateDustScore(const std::string& seq)
+// Pack a base into a 2-bit code. Returns -1 for non-ACGT symbols.
+static inline int dustBaseCode(char b)
+{
+    switch(b)
+    {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+// Dust score computed over arbitrary symbols using a map of 3-mer strings.
+// This is only used when the sequence is not entirely ACGT.
+static double calculateDustScoreGeneric(const std::string& seq)
 {
     std::map<std::string, int> scoreMap;
     
-    // Cannot calculate dust scores on very short reads
-    if(seq.size() < 3)
-        return 0.0f;
-
     // Slide a 3-mer window over the sequence and insert the sequences into the map
     for(size_t i = 0; i < seq.size() - 3; ++i)
     {
@@ -110,6 +117,39 @@ double calculateDustScore(const std::string& seq)
     return sum / (seq.size() - 2);
 }
 
+//
+// Dust scoring scheme as given by:
+// Morgulis A. "A fast and symmetric DUST implementation to Mask
+// Low-Complexity DNA Sequences". J Comp Bio.
+//
+// Each 3-mer is packed into a 6-bit code and counted in a fixed table.
+// The score, the sum of tc * (tc - 1) / 2 over all 3-mers, is accumulated
+// as the counts are incremented (adding tc when tc becomes tc + 1) so the
+// table never needs to be scanned.
+double calculateDustScore(const std::string& seq)
+{
+    // Cannot calculate dust scores on very short reads
+    if(seq.size() < 3)
+        return 0.0f;
+
+    // The 3-mers starting at positions [0, seq.size() - 3) are counted
+    size_t numTriMers = seq.size() - 3;
+    int counts[64] = { 0 };
+    int64_t sum = 0;
+    int code = 0;
+    for(size_t i = 0; i < numTriMers + 2; ++i)
+    {
+        int b = dustBaseCode(seq[i]);
+        if(b < 0)
+            return calculateDustScoreGeneric(seq);
+
+        code = ((code << 2) | b) & 63;
+        if(i >= 2)
+            sum += counts[code]++;
+    }
+    return (double)sum / (seq.size() - 2);
+}
+
 // Returns the window over seq with the highest dust score
 double maxDustWindow(const std::string& seq, size_t windowSize, size_t minWindow)
 {